@@ -2,141 +2,339 @@
  ************* Conway's game of life ******************
  ******************************************************
 
- Usage: ./exec ArraySize TimeSteps
+ Usage: ./exec [-e Engine] [-b Tile] [-d Depth] [-m MiB]
+               [-s Interval] [-o File] [-c Interval] [-k File] [-r]
+               [-R Rule] ArraySize TimeSteps
 
- Compile with -DOUTPUT to print output in output.gif
- (You will need ImageMagick for that - Install with
-  sudo apt-get install imagemagick)
- WARNING: Do not print output for large array sizes!
-          or multiple time steps!
+ Engines:
+   int     one int per cell behind row pointers (default)
+   packed  64 cells per 64-bit word, bit-parallel update
+   simd    one byte per cell, AVX2/AVX-512 kernel picked at runtime
+   tiled   simd kernel on Tile x Tile blocks, Depth generations per pass
+   sparse  simd kernel only on Tile x Tile blocks near last step's changes
+           (smaller tiles, e.g. -b 64, skip more)
+   hashlife memoized quadtree on the unbounded plane, nodes limited to
+           about MiB megabytes; matches the others away from the edges
+
+ -R picks the rule in B/S notation, e.g. B36/S23, or by name: life
+ (B3/S23, default), highlife, seeds, daynight, lifewithoutdeath. The
+ packed engine only runs B3/S23 and hashlife no rule with B0.
+
+ With -s Interval the board is saved every Interval generations into one
+ compressed, indexed file (default life.snap) by a background thread.
+ To make output.gif out of it (needs ImageMagick -
+ sudo apt-get install imagemagick):
+   python3 snapshot_to_pgm.py life.snap
+   convert -delay 20 out*.pgm output.gif
+
+ With -c Interval a checkpoint of the board is written every Interval
+ generations (default life.ckpt, or -k File). -r resumes from it and runs
+ on until generation TimeSteps. Time excludes the checkpoints, their cost
+ is reported separately as Checkpoint.
  ******************************************************/
 
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
 #include <sys/time.h>
+#include "life.h"
 
-#define FINALIZE "\
-convert -delay 20 out*.pgm output.gif\n\
-rm *pgm\n\
-"
+#define MIN(a,b) ((a)<(b)?(a):(b))
 
 int ** allocate_array(int N);
 void free_array(int ** array, int N);
-void init_random(int ** array1, int ** array2, int N);
-void print_to_pgm( int ** array, int N, int t );
+
+static const life_engine * engines[] = { &int_engine, &packed_engine, &simd_engine,
+	&tiled_engine, &sparse_engine, &hashlife_engine, NULL };
+
+int life_tile = 256;
+int life_depth = 8;
+int life_memory = 1024;
+
+static void usage(void) {
+	int e;
+	fprintf(stderr, "Usage: ./exec [-e Engine] [-b Tile] [-d Depth] [-m MiB] [-s Interval] [-o File]"
+		" [-c Interval] [-k File] [-r] [-R Rule] ArraySize TimeSteps\n");
+	fprintf(stderr, "Engines:");
+	for ( e = 0 ; engines[e] ; e++ )
+		fprintf(stderr, " %s", engines[e]->name);
+	fprintf(stderr, "\n");
+	exit(-1);
+}
 
 int main (int argc, char * argv[]) {
 	int N;	 			//array dimensions
 	int T; 				//time steps
-	int ** current, ** previous; 	//arrays - one for current timestep, one for previous timestep
-	int ** swap;			//array pointer
-	int t, i, j, nbrs;		//helper variables
-	int tid;
+	const life_engine * engine = &int_engine;
+	void * board;			//engine specific board
+	uint64_t * rows;		//bit-packed copy of the board
+	int e, opt, t, steps, start;	//helper variables
+	long alive;
+	char rule[24];
+	int interval = 0;		//generations between snapshots, 0 for none
+	const char * snapshot_path = "life.snap";
+	snapshot_writer * snapshots = NULL;
+	int checkpoint = 0;		//generations between checkpoints, 0 for none
+	const char * checkpoint_path = "life.ckpt";
+	int resume = 0;
 
-	double time;			//variables for timing
-	struct timeval ts,tf;
+	double time, tcheckpoint = 0;	//variables for timing
+	struct timeval ts,tf,tcs,tcf;
+
+	static struct option long_options[] = {
+		{ "engine", required_argument, NULL, 'e' },
+		{ "tile", required_argument, NULL, 'b' },
+		{ "depth", required_argument, NULL, 'd' },
+		{ "memory", required_argument, NULL, 'm' },
+		{ "snapshot", required_argument, NULL, 's' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "checkpoint", required_argument, NULL, 'c' },
+		{ "checkpoint-file", required_argument, NULL, 'k' },
+		{ "resume", no_argument, NULL, 'r' },
+		{ "rule", required_argument, NULL, 'R' },
+		{ NULL, 0, NULL, 0 }
+	};
 
 	/*Read input arguments*/
-	if ( argc != 3 ) {
-		fprintf(stderr, "Usage: ./exec ArraySize TimeSteps\n");
-		exit(-1);
+	while ( (opt = getopt_long(argc, argv, "e:b:d:m:s:o:c:k:rR:", long_options, NULL)) != -1 ) {
+		switch ( opt ) {
+		case 'e':
+			for ( e = 0 ; engines[e] ; e++ )
+				if ( strcmp(engines[e]->name, optarg) == 0 )
+					break;
+			if ( !engines[e] )
+				usage();
+			engine = engines[e];
+			break;
+		case 'b':
+			life_tile = atoi(optarg);
+			if ( life_tile < 1 )
+				usage();
+			break;
+		case 'd':
+			life_depth = atoi(optarg);
+			if ( life_depth < 1 )
+				usage();
+			break;
+		case 'm':
+			life_memory = atoi(optarg);
+			if ( life_memory < 1 )
+				usage();
+			break;
+		case 's':
+			interval = atoi(optarg);
+			if ( interval < 1 )
+				usage();
+			break;
+		case 'o':
+			snapshot_path = optarg;
+			break;
+		case 'c':
+			checkpoint = atoi(optarg);
+			if ( checkpoint < 1 )
+				usage();
+			break;
+		case 'k':
+			checkpoint_path = optarg;
+			break;
+		case 'r':
+			resume = 1;
+			break;
+		case 'R':
+			if ( parse_rule(optarg, &life_rule) != 0 )
+				usage();
+			break;
+		default:
+			usage();
+		}
 	}
+	if ( argc - optind != 2 )
+		usage();
 
-	N = atoi(argv[1]);
-	T = atoi(argv[2]);
+	N = atoi(argv[optind]);
+	T = atoi(argv[optind+1]);
 
-	/*Allocate and initialize matrices*/
-	current = allocate_array(N);			//allocate array for current time step
-	previous = allocate_array(N); 			//allocate array for previous time step
+	/*Allocate and initialize board*/
+	board = engine->create(N);
+	rows = calloc((size_t)N * PACKED_WORDS(N), sizeof(uint64_t));
 
-	init_random(previous, current, N);	//initialize previous array with pattern
+	if ( resume )
+		start = checkpoint_load(checkpoint_path, board, engine, N);
+	else {
+		init_random(board, engine, N);	//initialize board with pattern
+		start = 0;
+	}
 
-	#ifdef OUTPUT
-	print_to_pgm(previous, N, 0);
-	#endif
+	if ( interval ) {
+		snapshots = snapshot_open(snapshot_path, N);
+		engine->dump(board, snapshot_frame(snapshots));
+		snapshot_submit(snapshots, start);
+	}
 
 	/*Game of Life*/
 
 	gettimeofday(&ts,NULL);
-	for ( t = 0 ; t < T ; t++ ) {
-		#pragma omp parallel for schedule(static) private(nbrs, j)
-		for ( i = 1 ; i < N - 1; i++ ) {
-			for ( j = 1; j < N - 1; j++ ) {
-				nbrs = previous[i+1][j+1] + previous[i+1][j] + previous[i+1][j-1] \
-					+ previous[i][j-1] + previous[i][j+1] \
-					+ previous[i-1][j-1] + previous[i-1][j] + previous[i-1][j+1];
-				if ( nbrs == 3 || ( previous[i][j]+nbrs ==3 ) )
-					current[i][j]=1;
-				else
-					current[i][j]=0;
+	for ( t = start ; t < T ; t += steps ) {
+		//stop at every snapshot and checkpoint generation
+		steps = T - t;
+		if ( interval )
+			steps = MIN(steps, interval - t % interval);
+		if ( checkpoint )
+			steps = MIN(steps, checkpoint - t % checkpoint);
+		engine->advance(board, steps);
+		if ( interval && ( (t + steps) % interval == 0 || t + steps == T ) ) {
+			//waits only if the writer is still busy with the frame before
+			engine->dump(board, snapshot_frame(snapshots));
+			snapshot_submit(snapshots, t + steps);
+		}
+		if ( checkpoint && (t + steps) % checkpoint == 0 ) {
+			gettimeofday(&tcs,NULL);
+			engine->dump(board, rows);
+			checkpoint_save(checkpoint_path, rows, N, t + steps);
+			gettimeofday(&tcf,NULL);
+			tcheckpoint+=(tcf.tv_sec-tcs.tv_sec)+(tcf.tv_usec-tcs.tv_usec)*0.000001;
+		}
+	}
+	gettimeofday(&tf,NULL);
+	time=(tf.tv_sec-ts.tv_sec)+(tf.tv_usec-ts.tv_usec)*0.000001-tcheckpoint;
+
+	if ( interval )
+		snapshot_close(snapshots);
+
+	engine->dump(board, rows);
+	alive = count_alive(rows, N);
+
+	engine->destroy(board);
+	free(rows);
+	format_rule(life_rule, rule);
+	printf("GameOfLife: Size %d Steps %d Time %lf Threads %d Engine %s Alive %ld Checkpoint %lf Rule %s\n",
+		N, T, time, atoi(getenv("OMP_NUM_THREADS")), engine->name, alive, tcheckpoint, rule);
+}
+
+/*
+ The original engine: one int per cell, two boards swapped every step.
+*/
+typedef struct {
+	int N;
+	int ** current;		//array for current time step
+	int ** previous;	//array for previous time step
+} int_board;
+
+static void * int_create(int N) {
+	int_board * b = malloc(sizeof(int_board));
+	b->N = N;
+	b->current = allocate_array(N);
+	b->previous = allocate_array(N);
+	report_placement("int board", b->current[0],
+		(size_t)(b->current[N-1] + N - b->current[0]) * sizeof(int));
+	return b;
+}
+
+static void int_set(void * board, int i, int j) {
+	int_board * b = board;
+	b->previous[i][j] = 1;
+	b->current[i][j] = 1;
+}
+
+static void int_advance(void * board, int steps) {
+	int_board * b = board;
+	int N = b->N;
+	int ** current = b->current, ** previous = b->previous;
+	int ** swap;
+	int t, i, j, nbrs;
+	unsigned birth = life_rule.birth, survive = life_rule.survive;
+
+	for ( t = 0 ; t < steps ; t++ ) {
+		if ( IS_LIFE(life_rule) ) {
+			#pragma omp parallel for schedule(static) private(nbrs, j)
+			for ( i = 1 ; i < N - 1; i++ ) {
+				for ( j = 1; j < N - 1; j++ ) {
+					nbrs = previous[i+1][j+1] + previous[i+1][j] + previous[i+1][j-1] \
+						+ previous[i][j-1] + previous[i][j+1] \
+						+ previous[i-1][j-1] + previous[i-1][j] + previous[i-1][j+1];
+					if ( nbrs == 3 || ( previous[i][j]+nbrs ==3 ) )
+						current[i][j]=1;
+					else
+						current[i][j]=0;
+				}
+			}
+		}
+		else {
+			#pragma omp parallel for schedule(static) private(nbrs, j)
+			for ( i = 1 ; i < N - 1; i++ ) {
+				for ( j = 1; j < N - 1; j++ ) {
+					nbrs = previous[i+1][j+1] + previous[i+1][j] + previous[i+1][j-1] \
+						+ previous[i][j-1] + previous[i][j+1] \
+						+ previous[i-1][j-1] + previous[i-1][j] + previous[i-1][j+1];
+					current[i][j] = ( ( previous[i][j] ? survive : birth ) >> nbrs ) & 1;
+				}
 			}
 		}
 
-		#ifdef OUTPUT
-		print_to_pgm(current, N, t+1);
-		#endif
 		//Swap current array with previous array
 		swap=current;
 		current=previous;
 		previous=swap;
-
 	}
-	gettimeofday(&tf,NULL);
-	time=(tf.tv_sec-ts.tv_sec)+(tf.tv_usec-ts.tv_usec)*0.000001;
-
-	free_array(current, N);
-	free_array(previous, N);
-	printf("GameOfLife: Size %d Steps %d Time %lf Threads %d\n",
-		N, T, time, atoi(getenv("OMP_NUM_THREADS")));
-	#ifdef OUTPUT
-	system(FINALIZE);
-	#endif
+	b->current = current;
+	b->previous = previous;
 }
 
-int ** allocate_array(int N) {
-	int ** array;
-	int i,j;
-	array = malloc(N * sizeof(int*));
-	for ( i = 0; i < N ; i++ )
-		array[i] = malloc( N * sizeof(int));
-	for ( i = 0; i < N ; i++ )
-		for ( j = 0; j < N ; j++ )
-			array[i][j] = 0;
-	return array;
-}
+static void int_dump(void * board, uint64_t * rows) {
+	int_board * b = board;
+	int N = b->N, W = PACKED_WORDS(N);
+	int i, j;
 
-void free_array(int ** array, int N) {
-	int i;
+	memset(rows, 0, (size_t)N * W * sizeof(uint64_t));
 	for ( i = 0 ; i < N ; i++ )
-		free(array[i]);
-	free(array);
+		for ( j = 0 ; j < N ; j++ )
+			if ( b->previous[i][j] )
+				rows[(size_t)i*W + j/64] |= (uint64_t)1 << (j%64);
 }
 
-void init_random(int ** array1, int ** array2, int N) {
-	int i,pos,x,y;
+static void int_destroy(void * board) {
+	int_board * b = board;
+	free_array(b->current, b->N);
+	free_array(b->previous, b->N);
+	free(b);
+}
+
+const life_engine int_engine = {
+	"int", int_create, int_set, int_advance, int_dump, int_destroy
+};
 
-	for ( i = 0 ; i < (N * N)/10 ; i++ ) {
-		pos = rand() % ((N-2)*(N-2));
-		array1[pos%(N-2)+1][pos/(N-2)+1] = 1;
-		array2[pos%(N-2)+1][pos/(N-2)+1] = 1;
+/*
+ One aligned block with rows padded to whole cache lines, so rows are
+ neither scattered in the heap nor share a line with their neighbours.
+ The rows are zeroed in parallel with the same static split as the
+ compute loop, so with first touch every thread's rows are placed on
+ its own NUMA node.
+*/
+int ** allocate_array(int N) {
+	int ** array, * cells;
+	size_t stride = ((size_t)N * sizeof(int) + 63) / 64 * 64 / sizeof(int);
+	int i;
 
+	array = malloc(N * sizeof(int*));
+	cells = aligned_alloc(64, N * stride * sizeof(int));
+	if ( array == NULL || cells == NULL ) {
+		fprintf(stderr, "Error in allocation\n");
+		exit(-1);
 	}
-}
+	for ( i = 0 ; i < N ; i++ )
+		array[i] = cells + i * stride;
 
-void print_to_pgm(int ** array, int N, int t) {
-	int i,j;
-	char * s = malloc(30*sizeof(char));
-	sprintf(s,"out%d.pgm",t);
-	FILE * f = fopen(s,"wb");
-	fprintf(f, "P5\n%d %d 1\n", N,N);
-	for ( i = 0; i < N ; i++ )
-		for ( j = 0; j < N ; j++)
-			if ( array[i][j]==1 )
-				fputc(1,f);
-			else
-				fputc(0,f);
-	fclose(f);
-	free(s);
+	#pragma omp parallel for schedule(static)
+	for ( i = 1 ; i < N - 1 ; i++ )
+		memset(array[i], 0, stride * sizeof(int));
+	memset(array[0], 0, stride * sizeof(int));
+	memset(array[N-1], 0, stride * sizeof(int));
+	return array;
 }
 
+void free_array(int ** array, int N) {
+	free(array[0]);
+	free(array);
+}
@@ -0,0 +1,258 @@
+/******************************************************
+ ******** Conway's game of life, MPI + OpenMP *********
+ ******************************************************
+
+ Usage: mpirun ... ./Game_Of_Life_mpi ArraySize TimeSteps Px Py
+
+ The board is split into Px x Py blocks over a 2D Cartesian communicator,
+ the same way jacobi_mpi.c splits its domain, so boards larger than one
+ node's memory can be run. Every block carries a ring of ghost cells.
+ Unlike the 5-point stencils, a Life cell also reads its diagonal
+ neighbours, so the ghost corners are exchanged with the four diagonal
+ ranks as well.
+
+ Each step posts the nonblocking exchange of the previous generation,
+ updates the inner cells of the block (which read no ghost cells) with the
+ simd row kernel while the messages are in flight, waits, and then
+ updates the one cell wide frame of the block. OpenMP threads share the
+ rows of the block, only the master thread calls MPI.
+
+ Every rank draws the same rand() sequence as Game_Of_Life and keeps the
+ cells of its own block, so the Alive count matches the single node
+ engines for the same ArraySize and TimeSteps.
+ ******************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <omp.h>
+#include "mpi.h"
+#include "life.h"
+
+#define MAX(a,b) ((a)>(b)?(a):(b))
+#define MIN(a,b) ((a)<(b)?(a):(b))
+
+/* neighbour directions, opposite directions are d and d^1 */
+enum { NORTH, SOUTH, WEST, EAST, NORTHWEST, SOUTHEAST, NORTHEAST, SOUTHWEST, DIRECTIONS };
+
+static const int offsets[DIRECTIONS][2] = {
+	{ -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 },
+	{ -1, -1 }, { 1, 1 }, { -1, 1 }, { 1, -1 }
+};
+
+typedef struct {
+	int local[2];		//block dimensions without the ghost ring
+	int first[2];		//global coordinates of cell (1,1)
+	int lo[2], hi[2];	//block range [lo,hi) inside the live 1..N-2 region
+	size_t stride;		//bytes per row, multiple of 64
+	uint8_t * current;
+	uint8_t * previous;
+	row_kernel kernel;
+} block;
+
+/* keep the cells of our block while replaying the global seeding */
+static void block_set(void * board, int i, int j) {
+	block * b = board;
+	i -= b->first[0] - 1;
+	j -= b->first[1] - 1;
+	if ( i >= 1 && i <= b->local[0] && j >= 1 && j <= b->local[1] )
+		b->previous[i*b->stride + j] = 1;
+}
+
+static const life_engine seed_engine = { "mpi", NULL, block_set, NULL, NULL, NULL };
+
+/* next generation of cells [c0,c1) of row i */
+static void update_row(block * b, int i, int c0, int c1) {
+	size_t stride = b->stride;
+
+	if ( c1 > c0 )
+		b->kernel(b->previous + (i-1)*stride + c0 - 1, b->previous + i*stride + c0 - 1,
+			b->previous + (i+1)*stride + c0 - 1, b->current + i*stride + c0 - 1,
+			c1 - c0 + 2, NULL);
+}
+
+/* cells that do not read the ghost ring */
+static void update_inner(block * b) {
+	int i;
+
+	#pragma omp parallel for schedule(static)
+	for ( i = MAX(b->lo[0], 2) ; i < MIN(b->hi[0], b->local[0]) ; i++ )
+		update_row(b, i, MAX(b->lo[1], 2), MIN(b->hi[1], b->local[1]));
+}
+
+/* first and last row and column of the block, after the ghost ring arrived */
+static void update_frame(block * b) {
+	int i;
+
+	#pragma omp parallel for schedule(static)
+	for ( i = b->lo[0] ; i < b->hi[0] ; i++ ) {
+		if ( i == 1 || i == b->local[0] )
+			update_row(b, i, b->lo[1], b->hi[1]);
+		else {
+			if ( b->lo[1] == 1 )
+				update_row(b, i, 1, 2);
+			if ( b->hi[1] == b->local[1] + 1 && b->local[1] > 1 )
+				update_row(b, i, b->local[1], b->local[1] + 1);
+		}
+	}
+}
+
+/* first row/column sent towards direction d, or received from it */
+static int edge(int offset, int local, int ghost) {
+	if ( offset < 0 )
+		return ghost ? 0 : 1;
+	if ( offset > 0 )
+		return ghost ? local + 1 : local;
+	return 1;
+}
+
+int main(int argc, char * argv[]) {
+	int rank, size, provided;
+	int N;				//array dimensions
+	int T;				//time steps
+	int grid[2];			//processor grid dimensions
+	int neighbor[DIRECTIONS];
+	int t, d, k;
+	long local_alive = 0, alive;
+	block b;
+	uint8_t * swap;
+
+	double ttotal, tcomp = 0, total_time, comp_time;	//variables for timing
+	struct timeval tts, ttf, tcs, tcf;
+
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	if ( provided < MPI_THREAD_FUNNELED ) {
+		if ( rank == 0 )
+			fprintf(stderr, "MPI does not support MPI_THREAD_FUNNELED\n");
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	if ( argc != 5 ) {
+		fprintf(stderr, "Usage: mpirun .... ./exec ArraySize TimeSteps Px Py\n");
+		exit(-1);
+	}
+	N = atoi(argv[1]);
+	T = atoi(argv[2]);
+	grid[0] = atoi(argv[3]);
+	grid[1] = atoi(argv[4]);
+	if ( grid[0] * grid[1] != size ) {
+		if ( rank == 0 )
+			fprintf(stderr, "Px * Py must equal the number of processes (%d)\n", size);
+		MPI_Abort(MPI_COMM_WORLD, -1);
+	}
+
+	//----Create 2D-cartesian communicator----//
+
+	MPI_Comm CART_COMM;
+	int periods[2] = { 0, 0 };	//the board edge is dead, not periodic
+	int rank_grid[2], coords[2];
+
+	MPI_Cart_create(MPI_COMM_WORLD, 2, grid, periods, 0, &CART_COMM);
+	MPI_Comm_rank(CART_COMM, &rank);
+	MPI_Cart_coords(CART_COMM, rank, 2, rank_grid);
+
+	MPI_Cart_shift(CART_COMM, 0, 1, &neighbor[NORTH], &neighbor[SOUTH]);
+	MPI_Cart_shift(CART_COMM, 1, 1, &neighbor[WEST], &neighbor[EAST]);
+	for ( d = NORTHWEST ; d < DIRECTIONS ; d++ ) {
+		coords[0] = rank_grid[0] + offsets[d][0];
+		coords[1] = rank_grid[1] + offsets[d][1];
+		if ( coords[0] < 0 || coords[0] >= grid[0] || coords[1] < 0 || coords[1] >= grid[1] )
+			neighbor[d] = MPI_PROC_NULL;
+		else
+			MPI_Cart_rank(CART_COMM, coords, &neighbor[d]);
+	}
+
+	//----Local block, padded like jacobi_mpi.c when N does not divide----//
+
+	for ( k = 0 ; k < 2 ; k++ ) {
+		b.local[k] = ( N + grid[k] - 1 ) / grid[k];
+		b.first[k] = rank_grid[k] * b.local[k];
+		//only global cells 1..N-2 ever change
+		b.lo[k] = MAX(1, b.first[k]) - b.first[k] + 1;
+		b.hi[k] = MAX(MIN(N - 1, b.first[k] + b.local[k]) - b.first[k] + 1, b.lo[k]);
+	}
+	b.stride = ((size_t)b.local[1] + 2 + 63) / 64 * 64;
+	b.current = aligned_alloc(64, (b.local[0] + 2) * b.stride);
+	b.previous = aligned_alloc(64, (b.local[0] + 2) * b.stride);
+	memset(b.current, 0, (b.local[0] + 2) * b.stride);
+	memset(b.previous, 0, (b.local[0] + 2) * b.stride);
+	{
+		const char * name;
+		b.kernel = pick_row_kernel(&name);
+		if ( rank == 0 )
+			fprintf(stderr, "byte board: using %s kernel\n", name);
+	}
+
+	init_random(&b, &seed_engine, N);	//initialize board with pattern
+
+	//----Datatypes for the ghost ring----//
+
+	MPI_Datatype row, column, types[DIRECTIONS];
+	MPI_Type_contiguous(b.local[1], MPI_BYTE, &row);
+	MPI_Type_commit(&row);
+	MPI_Type_vector(b.local[0], 1, b.stride, MPI_BYTE, &column);
+	MPI_Type_commit(&column);
+	for ( d = 0 ; d < DIRECTIONS ; d++ )
+		types[d] = offsets[d][0] == 0 ? column : offsets[d][1] == 0 ? row : MPI_BYTE;
+
+	/*Game of Life*/
+
+	MPI_Request requests[2 * DIRECTIONS];
+	MPI_Barrier(CART_COMM);
+	gettimeofday(&tts, NULL);
+	for ( t = 0 ; t < T ; t++ ) {
+		for ( d = 0 ; d < DIRECTIONS ; d++ ) {
+			size_t ghost = edge(offsets[d][0], b.local[0], 1) * b.stride
+				+ edge(offsets[d][1], b.local[1], 1);
+			size_t inner = edge(offsets[d][0], b.local[0], 0) * b.stride
+				+ edge(offsets[d][1], b.local[1], 0);
+			//tag with the direction of travel, the receiver expects the opposite one
+			MPI_Irecv(b.previous + ghost, 1, types[d], neighbor[d], d ^ 1, CART_COMM,
+				&requests[2*d]);
+			MPI_Isend(b.previous + inner, 1, types[d], neighbor[d], d, CART_COMM,
+				&requests[2*d+1]);
+		}
+
+		gettimeofday(&tcs, NULL);
+		update_inner(&b);
+		gettimeofday(&tcf, NULL);
+		tcomp += (tcf.tv_sec - tcs.tv_sec) + (tcf.tv_usec - tcs.tv_usec) * 0.000001;
+
+		MPI_Waitall(2 * DIRECTIONS, requests, MPI_STATUSES_IGNORE);
+
+		gettimeofday(&tcs, NULL);
+		update_frame(&b);
+		gettimeofday(&tcf, NULL);
+		tcomp += (tcf.tv_sec - tcs.tv_sec) + (tcf.tv_usec - tcs.tv_usec) * 0.000001;
+
+		swap=b.current;
+		b.current=b.previous;
+		b.previous=swap;
+	}
+	gettimeofday(&ttf, NULL);
+	ttotal = (ttf.tv_sec - tts.tv_sec) + (ttf.tv_usec - tts.tv_usec) * 0.000001;
+
+	for ( k = 1 ; k <= b.local[0] ; k++ )
+		for ( d = 1 ; d <= b.local[1] ; d++ )
+			local_alive += b.previous[k*b.stride + d];
+
+	MPI_Reduce(&ttotal, &total_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Reduce(&tcomp, &comp_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	MPI_Reduce(&local_alive, &alive, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+	if ( rank == 0 )
+		printf("GameOfLife: Size %d Steps %d Time %lf Threads %d Engine mpi Alive %ld"
+			" Processes %d ComputationTime %lf\n",
+			N, T, total_time, omp_get_max_threads(), alive, size, comp_time);
+
+	MPI_Type_free(&row);
+	MPI_Type_free(&column);
+	free(b.current);
+	free(b.previous);
+	MPI_Finalize();
+	return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Every engine keeps its own board representation behind a void pointer.
+ Boards are N x N and the outer ring of cells always stays dead, exactly
+ like the original int implementation that only updates 1..N-2.
+*/
+typedef struct {
+	const char * name;
+	void * (*create)(int N);
+	void (*set)(void * board, int i, int j);	//make cell (i,j) alive, used for seeding
+	void (*advance)(void * board, int steps);	//compute the next steps generations
+	void (*dump)(void * board, uint64_t * rows);	//copy the board out as bit-packed rows
+	void (*destroy)(void * board);
+} life_engine;
+
+extern const life_engine int_engine;
+extern const life_engine packed_engine;
+extern const life_engine simd_engine;
+extern const life_engine tiled_engine;
+extern const life_engine sparse_engine;
+extern const life_engine hashlife_engine;
+
+/*
+ Outer-totalistic rule in B/S notation: bit n of birth is set when a dead
+ cell with n live neighbours is born, bit n of survive when a live cell
+ with n live neighbours stays alive. B3/S23 is Conway's rule.
+*/
+typedef struct {
+	uint16_t birth;
+	uint16_t survive;
+} outer_rule;
+
+#define LIFE_BIRTH (1 << 3)
+#define LIFE_SURVIVE (1 << 2 | 1 << 3)
+#define IS_LIFE(r) ((r).birth == LIFE_BIRTH && (r).survive == LIFE_SURVIVE)
+
+extern outer_rule life_rule;	//rule every engine runs, B3/S23 by default
+
+int parse_rule(const char * text, outer_rule * rule);
+void format_rule(outer_rule rule, char * text);
+
+/* engine parameters set from the command line */
+extern int life_tile;		//tile edge in cells
+extern int life_depth;		//generations per pass of the tiled engine
+extern int life_memory;		//MiB of nodes before hashlife collects garbage
+
+/*
+ Bit-packed rows are the common exchange format between engines:
+ row i starts at rows[i*PACKED_WORDS(N)] and cell j is bit j%64 of word j/64.
+*/
+#define PACKED_WORDS(N) (((N)+63)/64)
+
+/*
+ Contiguous byte-per-cell board shared by the simd, tiled and sparse
+ engines. Engines that keep more state embed it as their first member.
+ A row kernel computes cells 1..N-2 of one row into out and, if changes
+ is not NULL, sets bit 0 / bit 1 of it when the row differs from mid /
+ from the old contents of out.
+*/
+typedef void (*row_kernel)(const uint8_t * up, const uint8_t * mid,
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes);
+
+typedef struct {
+	int N;
+	size_t stride;		//bytes per row, multiple of 64
+	uint8_t * current;
+	uint8_t * previous;
+	row_kernel kernel;
+} byte_board;
+
+row_kernel pick_row_kernel(const char ** name);
+void * byte_create(int N);
+void byte_set(void * board, int i, int j);
+void byte_dump(void * board, uint64_t * rows);
+void byte_destroy(void * board);
+
+void init_random(void * board, const life_engine * engine, int N);
+long count_alive(const uint64_t * rows, int N);
+void report_placement(const char * what, const void * base, size_t bytes);
+
+/* background writer of compressed, indexed board snapshots */
+typedef struct snapshot_writer snapshot_writer;
+
+snapshot_writer * snapshot_open(const char * path, int N);
+uint64_t * snapshot_frame(snapshot_writer * w);
+void snapshot_submit(snapshot_writer * w, long generation);
+void snapshot_close(snapshot_writer * w);
+
+/* bit-packed, mmap-able checkpoints */
+void checkpoint_save(const char * path, const uint64_t * rows, int N, long generation);
+long checkpoint_load(const char * path, void * board, const life_engine * engine, int N);
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ Checkpoint/restart.
+
+ A checkpoint is one page of header followed by the board as bit-packed
+ rows, the same format dump() produces:
+   header  "LIFECKPT", uint32 version, uint32 N, uint64 generation,
+           uint64 words, zero padded to CHECKPOINT_HEADER bytes
+   rows    N * PACKED_WORDS(N) uint64 words, page aligned
+ Restoring maps the file and hands the live cells straight to the
+ engine, nothing is parsed or copied through stdio. The new checkpoint is
+ written next to the old one and renamed over it, so a job killed while
+ saving still finds the previous checkpoint.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "life.h"
+
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_HEADER 4096
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t N;
+	uint64_t generation;
+	uint64_t words;
+} checkpoint_header;
+
+void checkpoint_save(const char * path, const uint64_t * rows, int N, long generation) {
+	char header[CHECKPOINT_HEADER] = { 0 };
+	checkpoint_header * h = (checkpoint_header *)header;
+	char * tmp = malloc(strlen(path) + 5);
+	FILE * f;
+
+	memcpy(h->magic, "LIFECKPT", 8);
+	h->version = CHECKPOINT_VERSION;
+	h->N = N;
+	h->generation = generation;
+	h->words = (uint64_t)N * PACKED_WORDS(N);
+
+	sprintf(tmp, "%s.tmp", path);
+	f = fopen(tmp, "wb");
+	if ( f == NULL ) {
+		perror(tmp);
+		exit(-1);
+	}
+	if ( fwrite(header, 1, CHECKPOINT_HEADER, f) != CHECKPOINT_HEADER
+			|| fwrite(rows, sizeof(uint64_t), h->words, f) != h->words
+			|| fflush(f) != 0 || fsync(fileno(f)) != 0 ) {
+		perror(tmp);
+		exit(-1);
+	}
+	fclose(f);
+	if ( rename(tmp, path) != 0 ) {
+		perror(path);
+		exit(-1);
+	}
+	free(tmp);
+}
+
+/* set the cells stored in path on a freshly created board, returns the generation */
+long checkpoint_load(const char * path, void * board, const life_engine * engine, int N) {
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	const checkpoint_header * h;
+	const uint64_t * rows;
+	uint64_t word;
+	long generation;
+	int W = PACKED_WORDS(N);
+	int i, w;
+	void * map;
+
+	if ( fd < 0 || fstat(fd, &st) != 0 ) {
+		perror(path);
+		exit(-1);
+	}
+	if ( st.st_size < CHECKPOINT_HEADER ) {
+		fprintf(stderr, "%s: not a checkpoint\n", path);
+		exit(-1);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if ( map == MAP_FAILED ) {
+		perror(path);
+		exit(-1);
+	}
+	h = map;
+	if ( memcmp(h->magic, "LIFECKPT", 8) != 0 || h->version != CHECKPOINT_VERSION ) {
+		fprintf(stderr, "%s: not a checkpoint\n", path);
+		exit(-1);
+	}
+	if ( h->N != (uint32_t)N ) {
+		fprintf(stderr, "%s: board is %u x %u, not %d x %d\n", path, h->N, h->N, N, N);
+		exit(-1);
+	}
+	if ( (uint64_t)st.st_size < CHECKPOINT_HEADER + (uint64_t)N * W * sizeof(uint64_t) ) {
+		fprintf(stderr, "%s: truncated checkpoint\n", path);
+		exit(-1);
+	}
+
+	rows = (const uint64_t *)((const char *)map + CHECKPOINT_HEADER);
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	for ( i = 0 ; i < N ; i++ )
+		for ( w = 0 ; w < W ; w++ )
+			for ( word = rows[(size_t)i*W + w] ; word ; word &= word - 1 )
+				engine->set(board, i, w*64 + __builtin_ctzll(word));
+	generation = h->generation;
+	munmap(map, st.st_size);
+	return generation;
+}
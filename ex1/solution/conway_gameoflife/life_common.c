@@ -0,0 +1,138 @@
+/*
+ Helpers shared by Game_Of_Life and Game_Of_Life_mpi.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "life.h"
+
+#define MAX_NODES 64
+
+outer_rule life_rule = { LIFE_BIRTH, LIFE_SURVIVE };
+
+static const struct {
+	const char * name;
+	const char * rule;
+} named_rules[] = {
+	{ "life", "B3/S23" },
+	{ "highlife", "B36/S23" },
+	{ "seeds", "B2/S" },
+	{ "daynight", "B3678/S34678" },
+	{ "lifewithoutdeath", "B3/S012345678" },
+	{ NULL, NULL }
+};
+
+/*
+ Read "B36/S23" (either order, any case) or one of the names above.
+ Returns 0 on success, -1 if text is not a rule.
+*/
+int parse_rule(const char * text, outer_rule * rule) {
+	uint16_t * mask = NULL;
+	int i, seen_b = 0, seen_s = 0;
+
+	for ( i = 0 ; named_rules[i].name ; i++ )
+		if ( strcasecmp(text, named_rules[i].name) == 0 )
+			text = named_rules[i].rule;
+
+	rule->birth = rule->survive = 0;
+	for ( ; *text ; text++ ) {
+		if ( ( *text == 'B' || *text == 'b' ) && !seen_b ) {
+			mask = &rule->birth;
+			seen_b = 1;
+		}
+		else if ( ( *text == 'S' || *text == 's' ) && !seen_s ) {
+			mask = &rule->survive;
+			seen_s = 1;
+		}
+		else if ( *text >= '0' && *text <= '8' && mask )
+			*mask |= 1 << (*text - '0');
+		else if ( *text != '/' || !mask )
+			return -1;
+	}
+	return ( seen_b && seen_s ) ? 0 : -1;
+}
+
+/* text needs room for 22 characters */
+void format_rule(outer_rule rule, char * text) {
+	int n;
+
+	*text++ = 'B';
+	for ( n = 0 ; n <= 8 ; n++ )
+		if ( rule.birth & (1 << n) )
+			*text++ = '0' + n;
+	*text++ = '/';
+	*text++ = 'S';
+	for ( n = 0 ; n <= 8 ; n++ )
+		if ( rule.survive & (1 << n) )
+			*text++ = '0' + n;
+	*text = '\0';
+}
+
+/*
+ Same sequence of rand() draws for every engine, so all of them start
+ from the same pattern. Boards whose interior does not fit in RAND_MAX
+ combine two draws per cell.
+*/
+void init_random(void * board, const life_engine * engine, int N) {
+	long i, pos, cells, area;
+
+	cells = ((long)N * N) / 10;
+	area = (long)(N-2) * (N-2);
+	for ( i = 0 ; i < cells ; i++ ) {
+		if ( area <= RAND_MAX )
+			pos = rand() % area;
+		else
+			pos = ((long)rand() * ((long)RAND_MAX + 1) + rand()) % area;
+		engine->set(board, pos%(N-2)+1, pos/(N-2)+1);
+	}
+}
+
+long count_alive(const uint64_t * rows, int N) {
+	long i, alive = 0;
+
+	for ( i = 0 ; i < (long)N * PACKED_WORDS(N) ; i++ )
+		alive += __builtin_popcountll(rows[i]);
+	return alive;
+}
+
+/*
+ Print on which NUMA nodes the pages of a board ended up. move_pages with
+ no target nodes only reports the node of every page; it is called
+ through syscall() so no libnuma is needed.
+*/
+void report_placement(const char * what, const void * base, size_t bytes) {
+	long page = sysconf(_SC_PAGESIZE);
+	uintptr_t first = (uintptr_t)base / page * page;
+	size_t i, count = ((uintptr_t)base + bytes - first + page - 1) / page;
+	void ** pages = malloc(count * sizeof(void *));
+	int * status = malloc(count * sizeof(int));
+	long per_node[MAX_NODES] = { 0 }, other = 0;
+	int n;
+
+	for ( i = 0 ; i < count ; i++ )
+		pages[i] = (void *)(first + i * page);
+	if ( syscall(SYS_move_pages, 0, count, pages, NULL, status, 0) != 0 ) {
+		fprintf(stderr, "%s: %zu pages, placement unknown\n", what, count);
+		free(pages);
+		free(status);
+		return;
+	}
+	for ( i = 0 ; i < count ; i++ )
+		if ( status[i] >= 0 && status[i] < MAX_NODES )
+			per_node[status[i]]++;
+		else
+			other++;	//not faulted in or an error
+	fprintf(stderr, "%s: %zu pages", what, count);
+	for ( n = 0 ; n < MAX_NODES ; n++ )
+		if ( per_node[n] )
+			fprintf(stderr, ", node %d: %ld", n, per_node[n]);
+	if ( other )
+		fprintf(stderr, ", unplaced: %ld", other);
+	fprintf(stderr, "\n");
+	free(pages);
+	free(status);
+}
@@ -0,0 +1,439 @@
+/*
+ HashLife engine for very long runs.
+
+ The board is a quadtree whose nodes are canonicalized through a hash
+ table, so every distinct 2^k x 2^k square exists exactly once. The
+ RESULT of a level k node, its centre 2^(k-1) square advanced
+ 2^min(k-2,j) generations, is memoized in the node itself; j only
+ changes between the binary digits of the requested number of steps. Repeated
+ structure is then only ever computed once, and advancing 10^6 or more
+ generations costs a few hundred steps of 2^j generations each.
+
+ HashLife evolves the pattern on the unbounded plane, while the other
+ engines keep the outer ring of the N x N board dead. Both agree on every
+ cell farther than T cells from the board edge, which is how the small T
+ runs are compared. dump() returns the N x N window of the plane.
+
+ Nodes live in a pool limited to life_memory MiB. When the pool is full
+ the garbage collector keeps the nodes reachable from the root and from
+ the computation in progress, drops memoized results that point to freed
+ nodes and reuses the rest.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+#define MAX_LEVEL 62
+#define POOL_CHUNK 65536
+
+typedef struct node {
+	struct node * nw, * ne, * sw, * se;	//children, NULL for single cells
+	struct node * result;			//memoized RESULT for the current step
+	struct node * next;			//hash chain, free list
+	long population;
+	int level;
+	int mark;
+} node;
+
+typedef struct {
+	int N;
+	uint64_t * seed;	//cells set before the tree is built
+	node * root;
+	long ox, oy;		//board coordinates of the root's top left cell
+	int step;		//results are memoized for 2^step generations
+
+	node ** table;		//canonical nodes
+	size_t buckets, nodes, max_nodes;
+	node * free_nodes;
+	node ** chunks;		//pool allocations
+	int nchunks;
+	node * empty[MAX_LEVEL + 1];
+
+	node ** stack;		//nodes held by the computation in progress
+	int sp, stack_size;
+	long collections;
+} hashlife;
+
+static node leaf[2] = {
+	{ NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, 0 },
+	{ NULL, NULL, NULL, NULL, NULL, NULL, 1, 0, 0 }
+};
+
+static void collect(hashlife * h);
+
+static size_t hash(node * nw, node * ne, node * sw, node * se) {
+	size_t k = (size_t)nw * 0x9E3779B97F4A7C15ULL;
+	k = (k ^ (size_t)ne) * 0xBF58476D1CE4E5B9ULL;
+	k = (k ^ (size_t)sw) * 0x94D049BB133111EBULL;
+	k = (k ^ (size_t)se) * 0x9E3779B97F4A7C15ULL;
+	return k ^ (k >> 29);
+}
+
+static void rehash(hashlife * h, size_t buckets) {
+	node ** table = calloc(buckets, sizeof(node *));
+	node * n, * next;
+	size_t b, k;
+
+	for ( b = 0 ; b < h->buckets ; b++ )
+		for ( n = h->table[b] ; n ; n = next ) {
+			next = n->next;
+			k = hash(n->nw, n->ne, n->sw, n->se) & (buckets - 1);
+			n->next = table[k];
+			table[k] = n;
+		}
+	free(h->table);
+	h->table = table;
+	h->buckets = buckets;
+}
+
+static node * alloc_node(hashlife * h) {
+	node * n;
+	int i;
+
+	if ( !h->free_nodes ) {
+		node * chunk = malloc(POOL_CHUNK * sizeof(node));
+		h->chunks = realloc(h->chunks, (h->nchunks + 1) * sizeof(node *));
+		h->chunks[h->nchunks++] = chunk;
+		for ( i = 0 ; i < POOL_CHUNK ; i++ ) {
+			chunk[i].next = h->free_nodes;
+			h->free_nodes = &chunk[i];
+		}
+	}
+	n = h->free_nodes;
+	h->free_nodes = n->next;
+	return n;
+}
+
+/* the canonical node with these four children */
+static node * join(hashlife * h, node * nw, node * ne, node * sw, node * se) {
+	size_t k = hash(nw, ne, sw, se) & (h->buckets - 1);
+	node * n;
+
+	for ( n = h->table[k] ; n ; n = n->next )
+		if ( n->nw == nw && n->ne == ne && n->sw == sw && n->se == se )
+			return n;
+
+	//every node the caller still needs is on the stack or under the root
+	if ( h->nodes >= h->max_nodes ) {
+		collect(h);
+		k = hash(nw, ne, sw, se) & (h->buckets - 1);
+	}
+	if ( h->nodes >= h->buckets ) {
+		rehash(h, 2 * h->buckets);
+		k = hash(nw, ne, sw, se) & (h->buckets - 1);
+	}
+
+	n = alloc_node(h);
+	n->nw = nw;
+	n->ne = ne;
+	n->sw = sw;
+	n->se = se;
+	n->result = NULL;
+	n->population = nw->population + ne->population + sw->population + se->population;
+	n->level = nw->level + 1;
+	n->mark = 0;
+	n->next = h->table[k];
+	h->table[k] = n;
+	h->nodes++;
+	return n;
+}
+
+static node * push(hashlife * h, node * n) {
+	if ( h->sp == h->stack_size ) {
+		h->stack_size *= 2;
+		h->stack = realloc(h->stack, h->stack_size * sizeof(node *));
+	}
+	h->stack[h->sp++] = n;
+	return n;
+}
+
+static void mark(node * n) {
+	if ( n->level == 0 || n->mark )
+		return;
+	n->mark = 1;
+	mark(n->nw);
+	mark(n->ne);
+	mark(n->sw);
+	mark(n->se);
+}
+
+static void collect(hashlife * h) {
+	node * n, ** link;
+	size_t b;
+	int i;
+
+	if ( h->root )
+		mark(h->root);
+	for ( i = 0 ; i < h->sp ; i++ )
+		mark(h->stack[i]);
+	for ( i = 1 ; i <= MAX_LEVEL && h->empty[i] ; i++ )
+		mark(h->empty[i]);
+
+	//results of surviving nodes must not point to freed ones
+	for ( b = 0 ; b < h->buckets ; b++ )
+		for ( n = h->table[b] ; n ; n = n->next )
+			if ( n->mark && n->result && n->result->level > 0 && !n->result->mark )
+				n->result = NULL;
+
+	for ( b = 0 ; b < h->buckets ; b++ ) {
+		link = &h->table[b];
+		while ( (n = *link) ) {
+			if ( n->mark ) {
+				n->mark = 0;
+				link = &n->next;
+			}
+			else {
+				*link = n->next;
+				n->next = h->free_nodes;
+				h->free_nodes = n;
+				h->nodes--;
+			}
+		}
+	}
+	h->collections++;
+
+	//everything is live, grow rather than collect on every node
+	if ( h->nodes > h->max_nodes / 2 ) {
+		h->max_nodes += h->max_nodes / 2;
+		fprintf(stderr, "hashlife: live nodes exceed memory limit, raised to %zu MiB\n",
+			h->max_nodes * sizeof(node) >> 20);
+	}
+}
+
+static node * empty(hashlife * h, int level) {
+	node * e;
+
+	if ( level == 0 )
+		return &leaf[0];
+	if ( !h->empty[level] ) {
+		e = empty(h, level - 1);
+		h->empty[level] = join(h, e, e, e, e);
+	}
+	return h->empty[level];
+}
+
+/* level 2: the centre 2x2 one generation later */
+static node * base_result(hashlife * h, node * n) {
+	int cell[4][4], next[2][2];
+	node * q[2][2] = { { n->nw, n->ne }, { n->sw, n->se } };
+	int i, j, di, dj, nbrs;
+
+	for ( i = 0 ; i < 4 ; i++ )
+		for ( j = 0 ; j < 4 ; j++ ) {
+			node * c = q[i/2][j/2];
+			node * l = (i%2) ? ((j%2) ? c->se : c->sw) : ((j%2) ? c->ne : c->nw);
+			cell[i][j] = l->population;
+		}
+	for ( i = 1 ; i < 3 ; i++ )
+		for ( j = 1 ; j < 3 ; j++ ) {
+			nbrs = 0;
+			for ( di = -1 ; di <= 1 ; di++ )
+				for ( dj = -1 ; dj <= 1 ; dj++ )
+					if ( di || dj )
+						nbrs += cell[i+di][j+dj];
+			next[i-1][j-1] = ( ( cell[i][j] ? life_rule.survive : life_rule.birth ) >> nbrs ) & 1;
+		}
+	return join(h, &leaf[next[0][0]], &leaf[next[0][1]], &leaf[next[1][0]], &leaf[next[1][1]]);
+}
+
+static node * centre(hashlife * h, node * n) {
+	return join(h, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+/* centre 2^(k-1) square of n advanced 2^h->step generations */
+static node * result(hashlife * h, node * n) {
+	node * s[3][3], * r[3][3], * q[2][2], * res;
+	int sp = h->sp, full, i, j;
+
+	if ( n->result )
+		return n->result;
+	if ( n->population == 0 )
+		return n->result = empty(h, n->level - 1);
+	if ( n->level == 2 )
+		return n->result = base_result(h, n);
+
+	//nine overlapping subsquares of level k-1
+	s[0][0] = n->nw;
+	s[0][1] = push(h, join(h, n->nw->ne, n->ne->nw, n->nw->se, n->ne->sw));
+	s[0][2] = n->ne;
+	s[1][0] = push(h, join(h, n->nw->sw, n->nw->se, n->sw->nw, n->sw->ne));
+	s[1][1] = push(h, centre(h, n));
+	s[1][2] = push(h, join(h, n->ne->sw, n->ne->se, n->se->nw, n->se->ne));
+	s[2][0] = n->sw;
+	s[2][1] = push(h, join(h, n->sw->ne, n->se->nw, n->sw->se, n->se->sw));
+	s[2][2] = n->se;
+
+	//nodes up to level step+2 advance at full speed 2^(level-2) in two
+	//halves, larger ones only advance 2^step in the second half
+	full = ( n->level - 2 <= h->step );
+	for ( i = 0 ; i < 3 ; i++ )
+		for ( j = 0 ; j < 3 ; j++ )
+			r[i][j] = push(h, full ? result(h, s[i][j]) : centre(h, s[i][j]));
+
+	for ( i = 0 ; i < 2 ; i++ )
+		for ( j = 0 ; j < 2 ; j++ )
+			q[i][j] = push(h, result(h, push(h, join(h, r[i][j], r[i][j+1],
+						r[i+1][j], r[i+1][j+1]))));
+
+	res = join(h, q[0][0], q[0][1], q[1][0], q[1][1]);
+	h->sp = sp;
+	return n->result = res;
+}
+
+/* same pattern one level up, the old root in the centre */
+static node * expand(hashlife * h) {
+	node * r = h->root, * e = push(h, empty(h, r->level - 1));
+	node * nw = push(h, join(h, e, e, e, r->nw));
+	node * ne = push(h, join(h, e, e, r->ne, e));
+	node * sw = push(h, join(h, e, r->sw, e, e));
+	node * se = push(h, join(h, r->se, e, e, e));
+	long half = 1L << (r->level - 1);
+
+	h->root = join(h, nw, ne, sw, se);
+	h->sp -= 5;
+	h->ox -= half;
+	h->oy -= half;
+	return h->root;
+}
+
+/* whether all live cells are in the central half of the root */
+static int centred(node * r) {
+	return r->nw->population == r->nw->se->population
+		&& r->ne->population == r->ne->sw->population
+		&& r->sw->population == r->sw->ne->population
+		&& r->se->population == r->se->nw->population;
+}
+
+static node * build(hashlife * h, int level, long y, long x) {
+	node * nw, * ne, * sw, * se, * n;
+	long half;
+	int W = PACKED_WORDS(h->N);
+
+	if ( y >= h->N || x >= h->N )
+		return empty(h, level);
+	if ( level == 0 )
+		return &leaf[(h->seed[y*W + x/64] >> (x%64)) & 1];
+	half = 1L << (level - 1);
+	nw = push(h, build(h, level - 1, y, x));
+	ne = push(h, build(h, level - 1, y, x + half));
+	sw = push(h, build(h, level - 1, y + half, x));
+	se = push(h, build(h, level - 1, y + half, x + half));
+	n = join(h, nw, ne, sw, se);
+	h->sp -= 4;
+	return n;
+}
+
+static void build_root(hashlife * h) {
+	int level = 2;
+
+	while ( (1L << level) < h->N )
+		level++;
+	h->root = build(h, level, 0, 0);
+	h->ox = h->oy = 0;
+	free(h->seed);
+	h->seed = NULL;
+}
+
+static void * hashlife_create(int N) {
+	hashlife * h = calloc(1, sizeof(hashlife));
+
+	//with B0 empty space comes alive and the plane is never finite
+	if ( life_rule.birth & 1 ) {
+		fprintf(stderr, "hashlife cannot run rules with B0\n");
+		exit(-1);
+	}
+	h->N = N;
+	h->seed = calloc((size_t)N * PACKED_WORDS(N), sizeof(uint64_t));
+	h->buckets = 1 << 16;
+	h->table = calloc(h->buckets, sizeof(node *));
+	h->max_nodes = ((size_t)life_memory << 20) / sizeof(node);
+	h->stack_size = 1024;
+	h->stack = malloc(h->stack_size * sizeof(node *));
+	h->step = -1;
+	return h;
+}
+
+static void hashlife_set(void * board, int i, int j) {
+	hashlife * h = board;
+	h->seed[(size_t)i*PACKED_WORDS(h->N) + j/64] |= (uint64_t)1 << (j%64);
+}
+
+static void set_step(hashlife * h, int step) {
+	node * n;
+	size_t b;
+
+	if ( step == h->step )
+		return;
+	for ( b = 0 ; b < h->buckets ; b++ )
+		for ( n = h->table[b] ; n ; n = n->next )
+			n->result = NULL;
+	h->step = step;
+}
+
+static void hashlife_advance(void * board, int steps) {
+	hashlife * h = board;
+	int j;
+
+	if ( !h->root )
+		build_root(h);
+
+	for ( j = 0 ; (1L << j) <= steps ; j++ ) {
+		if ( !(steps & (1L << j)) )
+			continue;
+		set_step(h, j);
+		while ( h->root->level < j + 2 || !centred(h->root) )
+			expand(h);
+		//one more level keeps the result window 2^j cells clear of the pattern
+		expand(h);
+		h->root = result(h, h->root);
+		h->ox += 1L << (h->root->level - 1);
+		h->oy += 1L << (h->root->level - 1);
+	}
+}
+
+static void dump_node(hashlife * h, node * n, long y, long x, uint64_t * rows) {
+	long size = 1L << n->level;
+	int W = PACKED_WORDS(h->N);
+
+	if ( n->population == 0 || y >= h->N || x >= h->N || y + size <= 0 || x + size <= 0 )
+		return;
+	if ( n->level == 0 ) {
+		rows[y*W + x/64] |= (uint64_t)1 << (x%64);
+		return;
+	}
+	dump_node(h, n->nw, y, x, rows);
+	dump_node(h, n->ne, y, x + size/2, rows);
+	dump_node(h, n->sw, y + size/2, x, rows);
+	dump_node(h, n->se, y + size/2, x + size/2, rows);
+}
+
+static void hashlife_dump(void * board, uint64_t * rows) {
+	hashlife * h = board;
+
+	if ( !h->root )
+		build_root(h);
+	memset(rows, 0, (size_t)h->N * PACKED_WORDS(h->N) * sizeof(uint64_t));
+	dump_node(h, h->root, h->oy, h->ox, rows);
+}
+
+static void hashlife_destroy(void * board) {
+	hashlife * h = board;
+	int i;
+
+	fprintf(stderr, "hashlife: %zu nodes (%zu MiB) %ld collections, population %ld\n",
+		h->nodes, h->nodes * sizeof(node) >> 20, h->collections,
+		h->root ? h->root->population : 0);
+	for ( i = 0 ; i < h->nchunks ; i++ )
+		free(h->chunks[i]);
+	free(h->chunks);
+	free(h->table);
+	free(h->stack);
+	free(h->seed);
+	free(h);
+}
+
+const life_engine hashlife_engine = {
+	"hashlife", hashlife_create, hashlife_set, hashlife_advance, hashlife_dump, hashlife_destroy
+};
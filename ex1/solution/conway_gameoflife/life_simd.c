@@ -0,0 +1,416 @@
+/*
+ Byte-per-cell Game of Life engine with explicit SIMD kernels.
+
+ The board is one contiguous uint8_t block with a 64-byte aligned row
+ stride, so the eight neighbour loads of a row are plain unaligned vector
+ loads at offsets -1, 0 and +1 of the rows above, at and below. The row
+ kernel is picked once at startup: AVX-512BW, AVX2 or the scalar loop,
+ all producing the same board as the int engine. Set LIFE_SIMD to
+ avx512, avx2 or scalar to force a narrower kernel.
+
+ B3/S23 has its own hard-coded kernels, a few other well known rules get
+ table kernels specialized at compile time and any other rule runs the
+ same table kernels on the masks in life_rule.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include "life.h"
+
+/*
+ All kernels compute cells from..N-2 of a row. If changes is not NULL
+ they also OR into it bit 0 when a cell differs from mid (the previous
+ generation) and bit 1 when it differs from what out held before, which
+ the sparse engine uses to track activity without a second pass.
+*/
+static inline void row_scalar(const uint8_t * up, const uint8_t * mid,
+		const uint8_t * down, uint8_t * out, int from, int N, uint8_t * changes) {
+	int j, nbrs;
+	uint8_t next, diff = 0, diff2 = 0;
+
+	for ( j = from ; j < N - 1 ; j++ ) {
+		nbrs = up[j-1] + up[j] + up[j+1] + mid[j-1] + mid[j+1]
+			+ down[j-1] + down[j] + down[j+1];
+		next = ( nbrs == 3 || ( mid[j]+nbrs == 3 ) );
+		diff |= next ^ mid[j];
+		diff2 |= next ^ out[j];
+		out[j] = next;
+	}
+	if ( changes )
+		*changes |= ( diff != 0 ) | ( diff2 != 0 ) << 1;
+}
+
+static void row_generic(const uint8_t * up, const uint8_t * mid,
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes) {
+	row_scalar(up, mid, down, out, 1, N, changes);
+}
+
+__attribute__((target("avx2")))
+static void row_avx2(const uint8_t * up, const uint8_t * mid,
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes) {
+	const __m256i two = _mm256_set1_epi8(2), three = _mm256_set1_epi8(3);
+	const __m256i one = _mm256_set1_epi8(1);
+	__m256i nbrs, self, born, stays, next;
+	__m256i diff = _mm256_setzero_si256(), diff2 = _mm256_setzero_si256();
+	int j;
+
+	//a vector covers cells j..j+31 and reads up to j+32 <= N-1, the
+	//last vector is shifted back to end at cell N-2 instead of a scalar tail
+	for ( j = 1 ; j < N - 1 ; j += 32 ) {
+		if ( j + 32 > N - 1 ) {
+			if ( N - 2 < 32 )
+				break;
+			j = N - 1 - 32;
+		}
+		nbrs = _mm256_add_epi8(
+			_mm256_add_epi8(
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(up+j-1)),
+						_mm256_loadu_si256((const __m256i *)(up+j))),
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(up+j+1)),
+						_mm256_loadu_si256((const __m256i *)(mid+j-1)))),
+			_mm256_add_epi8(
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(mid+j+1)),
+						_mm256_loadu_si256((const __m256i *)(down+j-1))),
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(down+j)),
+						_mm256_loadu_si256((const __m256i *)(down+j+1)))));
+		self = _mm256_loadu_si256((const __m256i *)(mid+j));
+		born = _mm256_cmpeq_epi8(nbrs, three);
+		stays = _mm256_and_si256(_mm256_cmpeq_epi8(nbrs, two),
+				_mm256_cmpeq_epi8(self, one));
+		next = _mm256_and_si256(_mm256_or_si256(born, stays), one);
+		if ( changes ) {
+			diff = _mm256_or_si256(diff, _mm256_xor_si256(next, self));
+			diff2 = _mm256_or_si256(diff2, _mm256_xor_si256(next,
+					_mm256_loadu_si256((const __m256i *)(out+j))));
+		}
+		_mm256_storeu_si256((__m256i *)(out+j), next);
+	}
+	row_scalar(up, mid, down, out, j, N, changes);
+	if ( changes )
+		*changes |= (!_mm256_testz_si256(diff, diff)) | ((!_mm256_testz_si256(diff2, diff2)) << 1);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void row_avx512(const uint8_t * up, const uint8_t * mid,
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes) {
+	const __m512i two = _mm512_set1_epi8(2), three = _mm512_set1_epi8(3);
+	const __m512i one = _mm512_set1_epi8(1);
+	__m512i nbrs, self, next;
+	__m512i diff = _mm512_setzero_si512(), diff2 = _mm512_setzero_si512();
+	__mmask64 m, alive;
+	int j;
+
+	//masked loads and stores cover the tail, so short rows stay vectorized
+	for ( j = 1 ; j < N - 1 ; j += 64 ) {
+		m = ( N - 1 - j >= 64 ) ? ~(__mmask64)0 : ((__mmask64)1 << (N - 1 - j)) - 1;
+		if ( N - 1 - j >= 64 ) {
+			nbrs = _mm512_add_epi8(
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_loadu_si512(up+j-1), _mm512_loadu_si512(up+j)),
+					_mm512_add_epi8(_mm512_loadu_si512(up+j+1), _mm512_loadu_si512(mid+j-1))),
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_loadu_si512(mid+j+1), _mm512_loadu_si512(down+j-1)),
+					_mm512_add_epi8(_mm512_loadu_si512(down+j), _mm512_loadu_si512(down+j+1))));
+			self = _mm512_loadu_si512(mid+j);
+		}
+		else {
+			nbrs = _mm512_add_epi8(
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, up+j-1), _mm512_maskz_loadu_epi8(m, up+j)),
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, up+j+1), _mm512_maskz_loadu_epi8(m, mid+j-1))),
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, mid+j+1), _mm512_maskz_loadu_epi8(m, down+j-1)),
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, down+j), _mm512_maskz_loadu_epi8(m, down+j+1))));
+			self = _mm512_maskz_loadu_epi8(m, mid+j);
+		}
+		alive = _mm512_cmpeq_epi8_mask(nbrs, three)
+			| (_mm512_cmpeq_epi8_mask(nbrs, two) & _mm512_cmpeq_epi8_mask(self, one));
+		next = _mm512_maskz_mov_epi8(alive, one);
+		if ( changes ) {
+			diff = _mm512_or_si512(diff, _mm512_xor_si512(next, self));
+			diff2 = _mm512_or_si512(diff2, _mm512_xor_si512(next,
+					_mm512_maskz_loadu_epi8(m, out+j)));
+		}
+		_mm512_mask_storeu_epi8(out+j, m, next);
+	}
+	if ( changes )
+		*changes |= ( _mm512_test_epi8_mask(diff, diff) != 0 )
+			| ( _mm512_test_epi8_mask(diff2, diff2) != 0 ) << 1;
+}
+
+/*
+ Kernels for other outer-totalistic rules. The neighbour count indexes
+ two 16 byte tables holding bit n of the birth and survive masks, so one
+ pshufb each looks up 32 or 64 cells. The bodies are always inlined into
+ one set of wrappers per rule below: for the named rules the masks, and
+ so the tables, are compile-time constants; "any" reads life_rule.
+*/
+#define RULE_TABLE(m) (m)&1, (m)>>1&1, (m)>>2&1, (m)>>3&1, (m)>>4&1, (m)>>5&1, \
+	(m)>>6&1, (m)>>7&1, (m)>>8&1, 0, 0, 0, 0, 0, 0, 0
+
+static inline __attribute__((always_inline)) void rule_scalar(const uint8_t * up,
+		const uint8_t * mid, const uint8_t * down, uint8_t * out, int N,
+		uint8_t * changes, unsigned birth, unsigned survive) {
+	int j, n, nbrs;
+	uint8_t next, born, stays, diff = 0, diff2 = 0;
+
+	for ( j = 1 ; j < N - 1 ; j++ ) {
+		nbrs = up[j-1] + up[j] + up[j+1] + mid[j-1] + mid[j+1]
+			+ down[j-1] + down[j] + down[j+1];
+		//compares instead of a variable shift keep the loop vectorizable,
+		//with constant masks the unused counts drop out
+		born = stays = 0;
+		for ( n = 0 ; n <= 8 ; n++ ) {
+			born |= ( nbrs == n ) & ( birth >> n );
+			stays |= ( nbrs == n ) & ( survive >> n );
+		}
+		next = ( born ^ ( ( born ^ stays ) & mid[j] ) ) & 1;
+		diff |= next ^ mid[j];
+		diff2 |= next ^ out[j];
+		out[j] = next;
+	}
+	if ( changes )
+		*changes |= ( diff != 0 ) | ( diff2 != 0 ) << 1;
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline void rule_avx2(const uint8_t * up, const uint8_t * mid,
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes,
+		unsigned birth, unsigned survive) {
+	const __m256i born_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(RULE_TABLE(birth)));
+	const __m256i stays_table = _mm256_broadcastsi128_si256(_mm_setr_epi8(RULE_TABLE(survive)));
+	__m256i nbrs, self, born, stays, next;
+	__m256i diff = _mm256_setzero_si256(), diff2 = _mm256_setzero_si256();
+	int j;
+
+	//same shifted last vector as row_avx2
+	for ( j = 1 ; j < N - 1 ; j += 32 ) {
+		if ( j + 32 > N - 1 ) {
+			if ( N - 2 < 32 )
+				break;
+			j = N - 1 - 32;
+		}
+		nbrs = _mm256_add_epi8(
+			_mm256_add_epi8(
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(up+j-1)),
+						_mm256_loadu_si256((const __m256i *)(up+j))),
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(up+j+1)),
+						_mm256_loadu_si256((const __m256i *)(mid+j-1)))),
+			_mm256_add_epi8(
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(mid+j+1)),
+						_mm256_loadu_si256((const __m256i *)(down+j-1))),
+				_mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(down+j)),
+						_mm256_loadu_si256((const __m256i *)(down+j+1)))));
+		self = _mm256_loadu_si256((const __m256i *)(mid+j));
+		born = _mm256_shuffle_epi8(born_table, nbrs);
+		stays = _mm256_shuffle_epi8(stays_table, nbrs);
+		//self is 0 or 1, so this picks stays for live cells and born for dead ones
+		next = _mm256_xor_si256(born, _mm256_and_si256(_mm256_xor_si256(born, stays), self));
+		if ( changes ) {
+			diff = _mm256_or_si256(diff, _mm256_xor_si256(next, self));
+			diff2 = _mm256_or_si256(diff2, _mm256_xor_si256(next,
+					_mm256_loadu_si256((const __m256i *)(out+j))));
+		}
+		_mm256_storeu_si256((__m256i *)(out+j), next);
+	}
+	//only rows shorter than one vector get here
+	if ( j < N - 1 )
+		rule_scalar(up, mid, down, out, N, changes, birth, survive);
+	if ( changes )
+		*changes |= (!_mm256_testz_si256(diff, diff)) | ((!_mm256_testz_si256(diff2, diff2)) << 1);
+}
+
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline void rule_avx512(const uint8_t * up, const uint8_t * mid,
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes,
+		unsigned birth, unsigned survive) {
+	const __m512i born_table = _mm512_broadcast_i32x4(_mm_setr_epi8(RULE_TABLE(birth)));
+	const __m512i stays_table = _mm512_broadcast_i32x4(_mm_setr_epi8(RULE_TABLE(survive)));
+	__m512i nbrs, self, next;
+	__m512i diff = _mm512_setzero_si512(), diff2 = _mm512_setzero_si512();
+	__mmask64 m;
+	int j;
+
+	for ( j = 1 ; j < N - 1 ; j += 64 ) {
+		m = ( N - 1 - j >= 64 ) ? ~(__mmask64)0 : ((__mmask64)1 << (N - 1 - j)) - 1;
+		if ( N - 1 - j >= 64 ) {
+			nbrs = _mm512_add_epi8(
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_loadu_si512(up+j-1), _mm512_loadu_si512(up+j)),
+					_mm512_add_epi8(_mm512_loadu_si512(up+j+1), _mm512_loadu_si512(mid+j-1))),
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_loadu_si512(mid+j+1), _mm512_loadu_si512(down+j-1)),
+					_mm512_add_epi8(_mm512_loadu_si512(down+j), _mm512_loadu_si512(down+j+1))));
+			self = _mm512_loadu_si512(mid+j);
+		}
+		else {
+			nbrs = _mm512_add_epi8(
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, up+j-1), _mm512_maskz_loadu_epi8(m, up+j)),
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, up+j+1), _mm512_maskz_loadu_epi8(m, mid+j-1))),
+				_mm512_add_epi8(
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, mid+j+1), _mm512_maskz_loadu_epi8(m, down+j-1)),
+					_mm512_add_epi8(_mm512_maskz_loadu_epi8(m, down+j), _mm512_maskz_loadu_epi8(m, down+j+1))));
+			self = _mm512_maskz_loadu_epi8(m, mid+j);
+		}
+		//self ? stays : born, bit by bit
+		next = _mm512_ternarylogic_epi32(self, _mm512_shuffle_epi8(born_table, nbrs),
+				_mm512_shuffle_epi8(stays_table, nbrs), 0xAC);
+		if ( changes ) {
+			diff = _mm512_or_si512(diff, _mm512_xor_si512(next, self));
+			diff2 = _mm512_or_si512(diff2, _mm512_xor_si512(next,
+					_mm512_maskz_loadu_epi8(m, out+j)));
+		}
+		_mm512_mask_storeu_epi8(out+j, m, next);
+	}
+	if ( changes )
+		*changes |= ( _mm512_test_epi8_mask(diff, diff) != 0 )
+			| ( _mm512_test_epi8_mask(diff2, diff2) != 0 ) << 1;
+}
+
+#define RULE_KERNELS(name, birth, survive) \
+static void row_generic_##name(const uint8_t * up, const uint8_t * mid, \
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes) { \
+	rule_scalar(up, mid, down, out, N, changes, birth, survive); \
+} \
+__attribute__((target("avx2"))) \
+static void row_avx2_##name(const uint8_t * up, const uint8_t * mid, \
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes) { \
+	rule_avx2(up, mid, down, out, N, changes, birth, survive); \
+} \
+__attribute__((target("avx512f,avx512bw"))) \
+static void row_avx512_##name(const uint8_t * up, const uint8_t * mid, \
+		const uint8_t * down, uint8_t * out, int N, uint8_t * changes) { \
+	rule_avx512(up, mid, down, out, N, changes, birth, survive); \
+}
+
+RULE_KERNELS(highlife, 1<<3 | 1<<6, 1<<2 | 1<<3)
+RULE_KERNELS(seeds, 1<<2, 0)
+RULE_KERNELS(daynight, 1<<3 | 1<<6 | 1<<7 | 1<<8, 1<<3 | 1<<4 | 1<<6 | 1<<7 | 1<<8)
+RULE_KERNELS(life_table, LIFE_BIRTH, LIFE_SURVIVE)
+RULE_KERNELS(any, life_rule.birth, life_rule.survive)
+
+static const struct {
+	const char * name;
+	outer_rule rule;
+	row_kernel scalar, avx2, avx512;
+} rule_kernels[] = {
+	{ "life", { LIFE_BIRTH, LIFE_SURVIVE }, row_generic, row_avx2, row_avx512 },
+	//the table kernels on B3/S23, picked with LIFE_SIMD_TABLE set to compare them
+	{ "life-table", { LIFE_BIRTH, LIFE_SURVIVE },
+		row_generic_life_table, row_avx2_life_table, row_avx512_life_table },
+	{ "highlife", { 1<<3 | 1<<6, 1<<2 | 1<<3 },
+		row_generic_highlife, row_avx2_highlife, row_avx512_highlife },
+	{ "seeds", { 1<<2, 0 }, row_generic_seeds, row_avx2_seeds, row_avx512_seeds },
+	{ "daynight", { 1<<3 | 1<<6 | 1<<7 | 1<<8, 1<<3 | 1<<4 | 1<<6 | 1<<7 | 1<<8 },
+		row_generic_daynight, row_avx2_daynight, row_avx512_daynight },
+	//any other rule
+	{ "any", { 0, 0 }, row_generic_any, row_avx2_any, row_avx512_any },
+	{ NULL }
+};
+
+row_kernel pick_row_kernel(const char ** name) {
+	const char * force = getenv("LIFE_SIMD");
+	static char kernel_name[32];
+	int r;
+
+	for ( r = 0 ; rule_kernels[r+1].name ; r++ )
+		if ( rule_kernels[r].rule.birth == life_rule.birth
+				&& rule_kernels[r].rule.survive == life_rule.survive
+				&& !( r == 0 && getenv("LIFE_SIMD_TABLE") ) )
+			break;
+
+	__builtin_cpu_init();
+	*name = kernel_name;
+	if ( force && strcmp(force, "scalar") == 0 ) {
+		sprintf(kernel_name, "scalar %s", rule_kernels[r].name);
+		return rule_kernels[r].scalar;
+	}
+	if ( __builtin_cpu_supports("avx512bw") && !(force && strcmp(force, "avx2") == 0) ) {
+		sprintf(kernel_name, "avx512 %s", rule_kernels[r].name);
+		return rule_kernels[r].avx512;
+	}
+	if ( __builtin_cpu_supports("avx2") ) {
+		sprintf(kernel_name, "avx2 %s", rule_kernels[r].name);
+		return rule_kernels[r].avx2;
+	}
+	sprintf(kernel_name, "scalar %s", rule_kernels[r].name);
+	return rule_kernels[r].scalar;
+}
+
+void * byte_create(int N) {
+	byte_board * b = malloc(sizeof(byte_board));
+	const char * name;
+	int i;
+
+	b->N = N;
+	b->stride = ((size_t)N + 63) / 64 * 64;
+	b->current = aligned_alloc(64, N * b->stride);
+	b->previous = aligned_alloc(64, N * b->stride);
+	//first touch with the row split of simd_advance
+	#pragma omp parallel for schedule(static)
+	for ( i = 1 ; i < N - 1 ; i++ ) {
+		memset(b->current + i*b->stride, 0, b->stride);
+		memset(b->previous + i*b->stride, 0, b->stride);
+	}
+	memset(b->current, 0, b->stride);
+	memset(b->previous, 0, b->stride);
+	memset(b->current + (N-1)*b->stride, 0, b->stride);
+	memset(b->previous + (N-1)*b->stride, 0, b->stride);
+	b->kernel = pick_row_kernel(&name);
+	fprintf(stderr, "byte board: using %s kernel\n", name);
+	report_placement("byte board", b->current, N * b->stride);
+	return b;
+}
+
+void byte_set(void * board, int i, int j) {
+	byte_board * b = board;
+	b->previous[i*b->stride + j] = 1;
+}
+
+static void simd_advance(void * board, int steps) {
+	byte_board * b = board;
+	int N = b->N;
+	size_t stride = b->stride;
+	uint8_t * current = b->current, * previous = b->previous;
+	uint8_t * swap;
+	int t, i;
+
+	for ( t = 0 ; t < steps ; t++ ) {
+		#pragma omp parallel for schedule(static)
+		for ( i = 1 ; i < N - 1 ; i++ )
+			b->kernel(previous + (i-1)*stride, previous + i*stride,
+				previous + (i+1)*stride, current + i*stride, N, NULL);
+
+		swap=current;
+		current=previous;
+		previous=swap;
+	}
+	b->current = current;
+	b->previous = previous;
+}
+
+void byte_dump(void * board, uint64_t * rows) {
+	byte_board * b = board;
+	int N = b->N, W = PACKED_WORDS(N);
+	int i, j;
+
+	memset(rows, 0, (size_t)N * W * sizeof(uint64_t));
+	for ( i = 0 ; i < N ; i++ )
+		for ( j = 0 ; j < N ; j++ )
+			if ( b->previous[i*b->stride + j] )
+				rows[(size_t)i*W + j/64] |= (uint64_t)1 << (j%64);
+}
+
+void byte_destroy(void * board) {
+	byte_board * b = board;
+	free(b->current);
+	free(b->previous);
+	free(b);
+}
+
+const life_engine simd_engine = {
+	"simd", byte_create, byte_set, simd_advance, byte_dump, byte_destroy
+};
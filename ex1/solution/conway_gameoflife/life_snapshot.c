@@ -0,0 +1,179 @@
+/*
+ Asynchronous snapshot writer.
+
+ The compute loop dumps the board into one of two frame buffers and hands
+ it to a background thread, which encodes and writes it while the next
+ generations are computed. The loop only waits if it produces a frame
+ before the writer has finished the one before it.
+
+ All frames go to one file:
+   header   "LIFESNAP", uint32 version, uint32 N
+   frames   bit-packed rows (the dump() format), PackBits run-length coded
+   index    per frame uint64 generation, offset, encoded size
+   trailer  uint64 index offset, uint64 frame count, "LIFEINDX"
+ so any frame can be found from the end of the file without decoding the
+ others. snapshot_to_pgm.py turns frames back into images.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "life.h"
+
+#define SNAPSHOT_VERSION 1
+
+typedef struct {
+	uint64_t generation, offset, size;
+} snapshot_entry;
+
+struct snapshot_writer {
+	FILE * f;
+	int N;
+	size_t frame_bytes;
+	uint64_t * frames[2];		//double buffer shared with the compute loop
+	long generation[2];
+	int ready[2];			//frame handed to the writer, not yet written
+	int fill;			//buffer the compute loop fills next
+	int closing;
+	uint8_t * encoded;
+	snapshot_entry * index;
+	size_t entries, index_size;
+	uint64_t offset;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+};
+
+/* PackBits: 0..127 is followed by n+1 literal bytes, 129..255 repeats the next byte 257-n times */
+static size_t packbits(const uint8_t * in, size_t len, uint8_t * out) {
+	size_t i = 0, o = 0, run, lit;
+
+	while ( i < len ) {
+		for ( run = 1 ; i + run < len && run < 128 && in[i+run] == in[i] ; run++ )
+			;
+		if ( run > 1 ) {
+			out[o++] = (uint8_t)(257 - run);
+			out[o++] = in[i];
+			i += run;
+			continue;
+		}
+		//literals until the next run of at least three bytes
+		for ( lit = 1 ; i + lit < len && lit < 128 ; lit++ )
+			if ( i + lit + 2 < len && in[i+lit] == in[i+lit+1] && in[i+lit] == in[i+lit+2] )
+				break;
+		out[o++] = (uint8_t)(lit - 1);
+		memcpy(out + o, in + i, lit);
+		o += lit;
+		i += lit;
+	}
+	return o;
+}
+
+static void write_frame(snapshot_writer * w, int k) {
+	size_t size = packbits((const uint8_t *)w->frames[k], w->frame_bytes, w->encoded);
+
+	fwrite(w->encoded, 1, size, w->f);
+	if ( w->entries == w->index_size ) {
+		w->index_size = w->index_size ? 2 * w->index_size : 64;
+		w->index = realloc(w->index, w->index_size * sizeof(snapshot_entry));
+	}
+	w->index[w->entries].generation = w->generation[k];
+	w->index[w->entries].offset = w->offset;
+	w->index[w->entries].size = size;
+	w->entries++;
+	w->offset += size;
+}
+
+static void * writer_thread(void * arg) {
+	snapshot_writer * w = arg;
+	int k = 0;
+
+	for ( ;; ) {
+		pthread_mutex_lock(&w->lock);
+		while ( !w->ready[k] && !w->closing )
+			pthread_cond_wait(&w->changed, &w->lock);
+		if ( !w->ready[k] ) {
+			pthread_mutex_unlock(&w->lock);
+			break;
+		}
+		pthread_mutex_unlock(&w->lock);
+
+		write_frame(w, k);
+
+		pthread_mutex_lock(&w->lock);
+		w->ready[k] = 0;
+		pthread_cond_broadcast(&w->changed);
+		pthread_mutex_unlock(&w->lock);
+		k ^= 1;
+	}
+	return NULL;
+}
+
+snapshot_writer * snapshot_open(const char * path, int N) {
+	snapshot_writer * w = calloc(1, sizeof(snapshot_writer));
+	uint32_t head[2] = { SNAPSHOT_VERSION, N };
+
+	w->f = fopen(path, "wb");
+	if ( w->f == NULL ) {
+		perror(path);
+		exit(-1);
+	}
+	w->N = N;
+	w->frame_bytes = (size_t)N * PACKED_WORDS(N) * sizeof(uint64_t);
+	w->frames[0] = malloc(w->frame_bytes);
+	w->frames[1] = malloc(w->frame_bytes);
+	w->encoded = malloc(w->frame_bytes + w->frame_bytes / 128 + 1);
+	fwrite("LIFESNAP", 1, 8, w->f);
+	fwrite(head, sizeof(uint32_t), 2, w->f);
+	w->offset = 8 + 2 * sizeof(uint32_t);
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->changed, NULL);
+	pthread_create(&w->thread, NULL, writer_thread, w);
+	return w;
+}
+
+/* buffer for the next frame, waits while the writer still holds it */
+uint64_t * snapshot_frame(snapshot_writer * w) {
+	pthread_mutex_lock(&w->lock);
+	while ( w->ready[w->fill] )
+		pthread_cond_wait(&w->changed, &w->lock);
+	pthread_mutex_unlock(&w->lock);
+	return w->frames[w->fill];
+}
+
+/* hand the frame returned by snapshot_frame to the writer */
+void snapshot_submit(snapshot_writer * w, long generation) {
+	pthread_mutex_lock(&w->lock);
+	w->generation[w->fill] = generation;
+	w->ready[w->fill] = 1;
+	pthread_cond_broadcast(&w->changed);
+	pthread_mutex_unlock(&w->lock);
+	w->fill ^= 1;
+}
+
+/* write the remaining frames and the index */
+void snapshot_close(snapshot_writer * w) {
+	uint64_t trailer[2];
+
+	pthread_mutex_lock(&w->lock);
+	w->closing = 1;
+	pthread_cond_broadcast(&w->changed);
+	pthread_mutex_unlock(&w->lock);
+	pthread_join(w->thread, NULL);
+
+	trailer[0] = w->offset;
+	trailer[1] = w->entries;
+	fwrite(w->index, sizeof(snapshot_entry), w->entries, w->f);
+	fwrite(trailer, sizeof(uint64_t), 2, w->f);
+	fwrite("LIFEINDX", 1, 8, w->f);
+	fclose(w->f);
+
+	pthread_mutex_destroy(&w->lock);
+	pthread_cond_destroy(&w->changed);
+	free(w->frames[0]);
+	free(w->frames[1]);
+	free(w->encoded);
+	free(w->index);
+	free(w);
+}
@@ -0,0 +1,158 @@
+/*
+ Active-region tracking on the byte-per-cell board.
+
+ The board is split into life_tile x life_tile tiles and every tile keeps
+ a "changed last step" flag. A tile is recomputed only if it or one of
+ its eight neighbour tiles changed in the previous generation; otherwise
+ its next state is its current state. Because the tile did not change,
+ the older buffer we would overwrite already holds that state, so a
+ skipped tile costs nothing at all.
+
+ Blinkers and the other period-2 oscillators that fill the ash of a
+ random soup would keep almost every tile "changed", so a second flag
+ records whether the tile differs from two generations ago. If none of
+ the nine tiles did, the next state equals the one two generations ago,
+ which is again exactly what the older buffer holds.
+
+ Once a pattern settles into still lifes, blinkers and empty space, the
+ cost of a step follows the activity instead of N*N.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+#define MAX(a,b) ((a)>(b)?(a):(b))
+#define MIN(a,b) ((a)<(b)?(a):(b))
+
+typedef struct {
+	byte_board cells;
+	int tiles;		//tiles per side
+	uint8_t * changed;	//differs from one generation ago
+	uint8_t * changed2;	//differs from two generations ago
+	uint8_t * next_changed;	//the same flags for the step being computed
+	uint8_t * next_changed2;
+	long updated, skipped;	//tile updates done and avoided
+	int generation;
+} sparse_board;
+
+static void * sparse_create(int N) {
+	sparse_board * b = malloc(sizeof(sparse_board));
+	byte_board * cells = byte_create(N);
+
+	b->cells = *cells;
+	free(cells);
+	b->tiles = (N + life_tile - 1) / life_tile;
+	//everything is new in the first step
+	b->changed = malloc((size_t)b->tiles * b->tiles);
+	b->changed2 = malloc((size_t)b->tiles * b->tiles);
+	memset(b->changed, 1, (size_t)b->tiles * b->tiles);
+	memset(b->changed2, 1, (size_t)b->tiles * b->tiles);
+	b->next_changed = calloc((size_t)b->tiles * b->tiles, 1);
+	b->next_changed2 = calloc((size_t)b->tiles * b->tiles, 1);
+	b->updated = b->skipped = 0;
+	b->generation = 0;
+	return b;
+}
+
+/* whether any tile around (ti,tj) has its flag set */
+static int tile_active(sparse_board * b, const uint8_t * flags, int ti, int tj) {
+	int i, j;
+
+	for ( i = MAX(ti - 1, 0) ; i <= MIN(ti + 1, b->tiles - 1) ; i++ )
+		for ( j = MAX(tj - 1, 0) ; j <= MIN(tj + 1, b->tiles - 1) ; j++ )
+			if ( flags[i*b->tiles + j] )
+				return 1;
+	return 0;
+}
+
+/* recompute one tile, flagging whether it differs from the two older generations */
+static void tile_update(byte_board * c, int r0, int r1, int c0, int c1,
+		uint8_t * changed, uint8_t * changed2) {
+	size_t stride = c->stride;
+	uint8_t changes = 0;
+	int i;
+
+	r0 = MAX(r0, 1);
+	r1 = MIN(r1, c->N - 1);
+	c0 = MAX(c0, 1);
+	c1 = MIN(c1, c->N - 1);
+	for ( i = r0 ; i < r1 ; i++ )
+		c->kernel(c->previous + (i-1)*stride + c0 - 1, c->previous + i*stride + c0 - 1,
+			c->previous + (i+1)*stride + c0 - 1, c->current + i*stride + c0 - 1,
+			c1 - c0 + 2, &changes);
+	*changed = changes & 1;
+	*changed2 = ( changes >> 1 ) & 1;
+}
+
+static void sparse_advance(void * board, int steps) {
+	sparse_board * b = board;
+	byte_board * c = &b->cells;
+	int tiles = b->tiles, tile = life_tile, N = c->N;
+	long updated = 0, skipped = 0;
+	uint8_t * swap;
+	int t, k;
+
+	for ( t = 0 ; t < steps ; t++ ) {
+		//the older buffer holds no real generation before the first step
+		int first = ( b->generation++ == 0 );
+
+		#pragma omp parallel for schedule(dynamic, 16) reduction(+:updated,skipped)
+		for ( k = 0 ; k < tiles * tiles ; k++ ) {
+			int ti = k / tiles, tj = k % tiles;
+
+			if ( !tile_active(b, b->changed, ti, tj) ) {
+				//still: next = current = older buffer
+				b->next_changed[k] = 0;
+				b->next_changed2[k] = 0;
+				skipped++;
+			}
+			else if ( !tile_active(b, b->changed2, ti, tj) ) {
+				//period 2: next = two generations ago = older buffer
+				b->next_changed[k] = b->changed[k];
+				b->next_changed2[k] = 0;
+				skipped++;
+			}
+			else {
+				tile_update(c, ti*tile, MIN((ti+1)*tile, N),
+					tj*tile, MIN((tj+1)*tile, N),
+					&b->next_changed[k], &b->next_changed2[k]);
+				if ( first )
+					b->next_changed2[k] = 1;
+				updated++;
+			}
+		}
+
+		swap=c->current;
+		c->current=c->previous;
+		c->previous=swap;
+		swap=b->next_changed;
+		b->next_changed=b->changed;
+		b->changed=swap;
+		swap=b->next_changed2;
+		b->next_changed2=b->changed2;
+		b->changed2=swap;
+	}
+	b->updated += updated;
+	b->skipped += skipped;
+}
+
+static void sparse_destroy(void * board) {
+	sparse_board * b = board;
+
+	fprintf(stderr, "sparse: updated %ld skipped %ld tiles (%.1f%% skipped)\n",
+		b->updated, b->skipped,
+		b->updated + b->skipped ? 100.0 * b->skipped / (b->updated + b->skipped) : 0.0);
+	free(b->cells.current);
+	free(b->cells.previous);
+	free(b->changed);
+	free(b->changed2);
+	free(b->next_changed);
+	free(b->next_changed2);
+	free(b);
+}
+
+const life_engine sparse_engine = {
+	"sparse", sparse_create, byte_set, sparse_advance, byte_dump, sparse_destroy
+};
@@ -0,0 +1,93 @@
+/*
+ Temporal blocking (overlapped-halo tiling) on the byte-per-cell board.
+
+ Instead of streaming both boards through memory every generation, each
+ thread copies a life_tile x life_tile tile plus a halo of life_depth
+ cells into a private scratch pair and advances it life_depth generations
+ there. Every generation the valid part of the scratch shrinks by one
+ cell on each side, so after life_depth generations exactly the tile is
+ valid and is written back. The halo cells are computed redundantly by
+ neighbouring tiles, which is the price for touching DRAM once per
+ life_depth generations instead of once per generation.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "life.h"
+
+#define MAX(a,b) ((a)>(b)?(a):(b))
+#define MIN(a,b) ((a)<(b)?(a):(b))
+
+/*
+ Advance the tile [r0,r1)x[c0,c1) of src depth generations and store it
+ into dst. scratch holds two buffers of (tile+2*depth)^2 cells.
+*/
+static void tile_block(byte_board * b, const uint8_t * src, uint8_t * dst,
+		uint8_t * scratch, int r0, int r1, int c0, int c1, int depth) {
+	int N = b->N;
+	size_t stride = b->stride;
+	int hr0 = MAX(r0 - depth, 0), hr1 = MIN(r1 + depth, N);	//halo rows
+	int hc0 = MAX(c0 - depth, 0), hc1 = MIN(c1 + depth, N);	//halo columns
+	int w = hc1 - hc0, h = hr1 - hr0;
+	uint8_t * prev = scratch, * next = scratch + (size_t)h * w, * swap;
+	int g, i, lo, hi, clo, chi;
+
+	for ( i = hr0 ; i < hr1 ; i++ )
+		memcpy(prev + (size_t)(i-hr0)*w, src + i*stride + hc0, w);
+	memcpy(next, prev, (size_t)h * w);
+
+	for ( g = 1 ; g <= depth ; g++ ) {
+		//valid region after generation g, never touching the dead border ring
+		lo = MAX(r0 - depth + g, 1);
+		hi = MIN(r1 + depth - g, N - 1);
+		clo = MAX(c0 - depth + g, 1);
+		chi = MIN(c1 + depth - g, N - 1);
+		for ( i = lo ; i < hi ; i++ )
+			b->kernel(prev + (size_t)(i-1-hr0)*w + (clo-1-hc0),
+				prev + (size_t)(i-hr0)*w + (clo-1-hc0),
+				prev + (size_t)(i+1-hr0)*w + (clo-1-hc0),
+				next + (size_t)(i-hr0)*w + (clo-1-hc0), chi - clo + 2, NULL);
+		swap=next;
+		next=prev;
+		prev=swap;
+	}
+
+	for ( i = MAX(r0, 1) ; i < MIN(r1, N - 1) ; i++ )
+		memcpy(dst + i*stride + MAX(c0, 1), prev + (size_t)(i-hr0)*w + (MAX(c0, 1)-hc0),
+			MIN(c1, N - 1) - MAX(c0, 1));
+}
+
+static void tiled_advance(void * board, int steps) {
+	byte_board * b = board;
+	int N = b->N, tile = life_tile;
+	int tiles = (N + tile - 1) / tile;
+	uint8_t * swap;
+	int t, depth;
+
+	for ( t = 0 ; t < steps ; t += depth ) {
+		depth = MIN(life_depth, steps - t);
+
+		#pragma omp parallel
+		{
+			int edge = tile + 2 * depth;
+			uint8_t * scratch = malloc(2 * (size_t)edge * edge);
+			int k;
+
+			#pragma omp for schedule(dynamic)
+			for ( k = 0 ; k < tiles * tiles ; k++ ) {
+				int r0 = (k / tiles) * tile, c0 = (k % tiles) * tile;
+				tile_block(b, b->previous, b->current, scratch,
+					r0, MIN(r0 + tile, N), c0, MIN(c0 + tile, N), depth);
+			}
+			free(scratch);
+		}
+
+		swap=b->current;
+		b->current=b->previous;
+		b->previous=swap;
+	}
+}
+
+const life_engine tiled_engine = {
+	"tiled", byte_create, byte_set, tiled_advance, byte_dump, byte_destroy
+};
@@ -11,17 +11,21 @@ def parse_file(fname):
         size_stats = {}
         for line in lines:
                 # line of the form:
-                # GameOfLife: Size <array_size> Steps 1000 Time <elapsed_time> Threads <thread_num>
-                splitted = line.split(" ")
+                # GameOfLife: Size <array_size> Steps 1000 Time <elapsed_time> Threads <thread_num> [Engine <engine> ...]
+                splitted = line.split()
                 # size of array
                 array_size = splitted[2]
                 # elapsed time
                 elapsed_time = splitted[6]
                 # thread number
                 thread_num = splitted[8]
+                # engine, runs before engines were added used int
+                engine = splitted[10] if len(splitted) > 10 else "int"
                 if not size_stats.get(array_size, None):
-                        size_stats[array_size] = []
-                size_stats[array_size].append({"elapsed": elapsed_time, "nthread": thread_num})
+                        size_stats[array_size] = {}
+                if not size_stats[array_size].get(engine, None):
+                        size_stats[array_size][engine] = []
+                size_stats[array_size][engine].append({"elapsed": elapsed_time, "nthread": thread_num})
         return size_stats
 
 if len(sys.argv) < 2:
@@ -30,12 +34,12 @@ if len(sys.argv) < 2:
 
 stats_by_size = parse_file(sys.argv[1])
 
-markers = set(['.', 'o', 'v', '*', 'D', 'X'])
+markers = ['.', 'o', 'v', '*', 'D', 'X']
 
 x_ticks = [1, 2, 4, 6, 8]
 serial_time = {}
 i = 0
-for size, stats in stats_by_size.items():
+for size, engine_stats in stats_by_size.items():
     i += 1
     fig = plt.figure(i)
     plt.grid(True)
@@ -44,18 +48,20 @@ for size, stats in stats_by_size.items():
     ax.set_ylabel("Time (seconds)")
     ax.xaxis.set_ticks(x_ticks)
     ax.xaxis.set_ticklabels(map(str, x_ticks))
-    y_axis = [0 for _ in range(len(x_ticks))]
-    for stat in stats:
-        pos = x_ticks.index(int(stat["nthread"]))
-        if int(stat["nthread"]) == 1:
-            serial_time[size] = float(stat["elapsed"])
-        y_axis[pos] = float(stat["elapsed"])
+    for j, engine in enumerate(sorted(engine_stats.keys())):
+        y_axis = [0 for _ in range(len(x_ticks))]
+        for stat in engine_stats[engine]:
+            pos = x_ticks.index(int(stat["nthread"]))
+            # speedups are relative to the serial time of the original engine
+            if int(stat["nthread"]) == 1 and (engine == "int" or size not in serial_time):
+                serial_time[size] = float(stat["elapsed"])
+            y_axis[pos] = float(stat["elapsed"])
 
-    ax.plot(x_ticks, tuple(y_axis), label="N="+size, marker=markers.pop())
-    lgd = ax.legend(ncol=len(stats_by_size.keys()), bbox_to_anchor=(0.9, -0.1), prop={'size':8})
+        ax.plot(x_ticks, tuple(y_axis), label="N="+size+" "+engine, marker=markers[j])
+    lgd = ax.legend(ncol=len(engine_stats.keys()), bbox_to_anchor=(0.9, -0.1), prop={'size':8})
     plt.savefig("stats-time-" + size + ".png", bbox_extra_artists=(lgd,), bbox_inches='tight')
 
-for size, stats in stats_by_size.items():
+for size, engine_stats in stats_by_size.items():
     i += 1
     fig = plt.figure(i)
     plt.grid(True)
@@ -64,11 +70,12 @@ for size, stats in stats_by_size.items():
     ax.set_ylabel("Speedup (Serial Time / Parallel Time)")
     ax.xaxis.set_ticks(x_ticks)
     ax.xaxis.set_ticklabels(map(str, x_ticks))
-    y_axis = [0 for _ in range(len(x_ticks))]
-    for stat in stats:
-        pos = x_ticks.index(int(stat["nthread"]))
-        y_axis[pos] = serial_time[size] / float(stat["elapsed"])
+    for j, engine in enumerate(sorted(engine_stats.keys())):
+        y_axis = [0 for _ in range(len(x_ticks))]
+        for stat in engine_stats[engine]:
+            pos = x_ticks.index(int(stat["nthread"]))
+            y_axis[pos] = serial_time[size] / float(stat["elapsed"])
 
-    ax.plot(x_ticks, tuple(y_axis), label="N="+size, marker=markers.pop())
-    lgd = ax.legend(ncol=len(stats_by_size.keys()), bbox_to_anchor=(0.9, -0.1), prop={'size':8})
+        ax.plot(x_ticks, tuple(y_axis), label="N="+size+" "+engine, marker=markers[j])
+    lgd = ax.legend(ncol=len(engine_stats.keys()), bbox_to_anchor=(0.9, -0.1), prop={'size':8})
     plt.savefig("stats-speedup-" + size + ".png", bbox_extra_artists=(lgd,), bbox_inches='tight')
@@ -21,13 +21,17 @@ cd /home/parallel/parlab13/vitsalis/conway_gameoflife
 
 nthreads=( 1 2 4 6 8 )
 sizes=( 64 1024 4096 )
+engines=( int packed simd tiled sparse )
 
-for nthread in "${nthreads[@]}";
+for engine in "${engines[@]}";
 do
-	for size in "${sizes[@]}";
+	for nthread in "${nthreads[@]}";
 	do
-		export OMP_NUM_THREADS=${nthread};
-		./Game_Of_Life ${size} 1000;
+		for size in "${sizes[@]}";
+		do
+			export OMP_NUM_THREADS=${nthread};
+			./Game_Of_Life -e ${engine} ${size} 1000;
+		done
 	done
 done
 
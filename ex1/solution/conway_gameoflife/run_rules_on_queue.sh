@@ -0,0 +1,36 @@
+#!/bin/bash
+
+## Give the Job a descriptive name
+#PBS -N run_conway_rules
+
+## Output and error files
+#PBS -o run_conway_rules.out
+#PBS -e run_conway_rules.err
+
+## How many machines should we get? 
+#PBS -l nodes=1:ppn=8
+
+##How long should the job run for?
+#PBS -l walltime=00:10:00
+
+## Compares the hard-coded B3/S23 kernels with the table kernels
+## (life-table is B3/S23 through the tables, B36/S24 has no specialized kernel)
+
+module load openmp
+cd /home/parallel/parlab13/vitsalis/conway_gameoflife
+
+kernels=( avx512 avx2 scalar )
+rules=( life life-table highlife daynight B36/S24 )
+export OMP_NUM_THREADS=1
+
+for kernel in "${kernels[@]}";
+do
+	for rule in "${rules[@]}";
+	do
+		if [ "${rule}" == "life-table" ]; then
+			LIFE_SIMD=${kernel} LIFE_SIMD_TABLE=1 ./Game_Of_Life -e simd -R life 4096 100;
+		else
+			LIFE_SIMD=${kernel} ./Game_Of_Life -e simd -R ${rule} 4096 100;
+		fi
+	done
+done
@@ -0,0 +1,50 @@
+import struct
+import sys
+
+# Writes out<generation>.pgm for the frames of a Game_Of_Life snapshot file
+# (see life_snapshot.c for the layout), optionally only generations in [first, last].
+
+def unpackbits(data, size):
+        out = bytearray()
+        i = 0
+        while len(out) < size:
+                n = data[i]
+                i += 1
+                if n < 128:
+                        out += data[i:i+n+1]
+                        i += n + 1
+                elif n > 128:
+                        out += bytes([data[i]]) * (257 - n)
+                        i += 1
+        return out
+
+if len(sys.argv) < 2:
+    print ("Usage snapshot_to_pgm.py <snapshot_file> [first last]")
+    exit(-1)
+
+with open(sys.argv[1], "rb") as f:
+        data = f.read()
+
+if data[:8] != b"LIFESNAP" or data[-8:] != b"LIFEINDX":
+    print ("Not a snapshot file")
+    exit(-1)
+
+version, N = struct.unpack_from("<II", data, 8)
+index_offset, frames = struct.unpack_from("<QQ", data, len(data) - 24)
+first = int(sys.argv[2]) if len(sys.argv) > 2 else 0
+last = int(sys.argv[3]) if len(sys.argv) > 3 else float("inf")
+words = (N + 63) // 64
+
+for k in range(frames):
+        generation, offset, size = struct.unpack_from("<QQQ", data, index_offset + 24 * k)
+        if generation < first or generation > last:
+                continue
+        rows = unpackbits(data[offset:offset+size], N * words * 8)
+        pixels = bytearray(N * N)
+        for i in range(N):
+                row = int.from_bytes(rows[i*words*8:(i+1)*words*8], "little")
+                for j in range(N):
+                        pixels[i*N + j] = (row >> j) & 1
+        with open("out%d.pgm" % generation, "wb") as out:
+                out.write(b"P5\n%d %d 1\n" % (N, N))
+                out.write(pixels)
@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "incremental.h"
+
+long fw_decrease(matrix *A, const edge_update *e, int n)
+{
+     int N = A->N;
+     long changed = 0;
+     int i, j, t;
+
+     if (A->B != 0) {
+        fprintf(stderr, "fw_decrease: the matrix must be row-major\n");
+        exit(-1);
+     }
+     for(t=0; t<n; t++) {
+        int u = e[t].u, v = e[t].v, w = e[t].w;
+        /* row v and column u do not change, A[v][u] + w >= 0 */
+        const int *Av = &MAT(A,v,0);
+
+        if (w >= MAT(A,u,v))
+           continue;
+        #pragma omp parallel for private(j) reduction(+:changed)
+        for(i=0; i<N; i++) {
+           int *Ai = &MAT(A,i,0);
+           int via = Ai[u] + w;
+
+           if (via >= Ai[v])
+              continue;
+           for(j=0; j<N; j++)
+              if (via + Av[j] < Ai[j]) {
+                 Ai[j] = via + Av[j];
+                 changed++;
+              }
+        }
+     }
+     return changed;
+}
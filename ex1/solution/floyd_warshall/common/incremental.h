@@ -0,0 +1,27 @@
+/*
+  Incremental all-pairs shortest paths.
+
+  Given a row-major matrix that already holds all shortest distances,
+  fw_decrease() applies a batch of new edges or edge weight decreases.
+  A path that gets shorter through the new edge (u,v) must use it, so
+
+    A[i][j] = min(A[i][j], A[i][u] + w + A[v][j])
+
+  brings every pair up to date in O(N^2) per edge. Rows for which
+  A[i][u] + w is no better than A[i][v] cannot change and are skipped.
+  Increases would need a recomputation and are not handled.
+*/
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "matrix.h"
+
+typedef struct {
+     int u, v;       /* edge u -> v */
+     int w;          /* its new weight */
+} edge_update;
+
+/* returns the number of distances that got shorter */
+long fw_decrease(matrix *A, const edge_update *e, int n);
+
+#endif
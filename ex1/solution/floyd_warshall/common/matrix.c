@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "matrix.h"
+
+#define ALIGN_INTS (MATRIX_ALIGN/sizeof(int))
+
+static int *alloc_block(size_t ints)
+{
+     int *p = aligned_alloc(MATRIX_ALIGN, (ints*sizeof(int)+MATRIX_ALIGN-1)/MATRIX_ALIGN*MATRIX_ALIGN);
+
+     if (p == NULL) {
+        fprintf(stderr, "Error in allocation\n");
+        exit(-1);
+     }
+     return p;
+}
+
+static void set_rows(matrix *m)
+{
+     int i;
+
+     for(i=0; i<m->N; i++)
+        m->rows[i] = m->data + (size_t)i*m->ld;
+}
+
+matrix *matrix_alloc(int N)
+{
+     matrix *m = malloc(sizeof(matrix));
+
+     m->N = N;
+     m->ld = (N+ALIGN_INTS-1)/ALIGN_INTS*ALIGN_INTS;
+     if ((m->ld*sizeof(int)) % 4096 == 0)
+        m->ld += ALIGN_INTS;
+     m->B = 0;
+     m->zorder = 0;
+     m->data = alloc_block((size_t)N*m->ld);
+     m->rows = malloc(N*sizeof(int *));
+     set_rows(m);
+     return m;
+}
+
+void matrix_free(matrix *m)
+{
+     free(m->data);
+     free(m->rows);
+     free(m);
+}
+
+/* offset of the tile holding element (I,J) of a blocked matrix */
+static size_t tile_offset(const matrix *m, int I, int J)
+{
+     size_t z = 0;
+     int bit;
+
+     if (!m->zorder)
+        return TILE(m,I,J) - m->data;
+     I /= m->B;
+     J /= m->B;
+     /* interleave the bits, row bits above column bits */
+     for(bit=0; (I|J) >> bit; bit++)
+        z |= (size_t)((I >> bit) & 1) << (2*bit+1) | (size_t)((J >> bit) & 1) << (2*bit);
+     return z*m->B*m->B;
+}
+
+static void to_tiles(matrix *m, int B, int zorder)
+{
+     int N = m->N;
+     int *tiles;
+     int I,J,i;
+
+     if (N % B != 0) {
+        fprintf(stderr, "matrix_block: N=%d is not a multiple of B=%d\n", N, B);
+        exit(-1);
+     }
+     tiles = alloc_block((size_t)N*N);
+     m->B = B;
+     m->zorder = zorder;
+     for(I=0; I<N; I+=B)
+        for(J=0; J<N; J+=B)
+           for(i=0; i<B; i++)
+              memcpy(tiles + tile_offset(m,I,J) + (size_t)i*B,
+                     m->data + (size_t)(I+i)*m->ld + J, B*sizeof(int));
+     free(m->data);
+     m->data = tiles;
+}
+
+/* row-major to tile-major, N must be a multiple of B */
+void matrix_block(matrix *m, int B)
+{
+     to_tiles(m, B, 0);
+}
+
+/* row-major to tiles in Z-order, N/B must be a power of two */
+void matrix_zorder(matrix *m, int B)
+{
+     if (B < 1 || m->N % B != 0 || ((m->N/B) & (m->N/B-1)) != 0) {
+        fprintf(stderr, "matrix_zorder: N/B=%d/%d is not a power of two\n", m->N, B);
+        exit(-1);
+     }
+     to_tiles(m, B, 1);
+}
+
+void matrix_unblock(matrix *m)
+{
+     int N = m->N, B = m->B;
+     int *flat = alloc_block((size_t)N*m->ld);
+     int I,J,i;
+
+     for(I=0; I<N; I+=B)
+        for(J=0; J<N; J+=B)
+           for(i=0; i<B; i++)
+              memcpy(flat + (size_t)(I+i)*m->ld + J, m->data + tile_offset(m,I,J) + (size_t)i*B,
+                     B*sizeof(int));
+     free(m->data);
+     m->data = flat;
+     m->B = 0;
+     m->zorder = 0;
+     set_rows(m);
+}
@@ -0,0 +1,50 @@
+/*
+  Flat matrix storage shared by the Floyd-Warshall drivers.
+
+  The N x N matrix is one 64-byte aligned block. In row-major form rows
+  are ld ints apart, ld padded to whole cache lines (and away from
+  multiples of 4 KiB, which would map every row onto the same cache
+  sets). rows[] points into the block, so code written for int** such as
+  graph_init_random still works on it.
+
+  matrix_block() rearranges the block tile-major: the B x B tiles are
+  stored one after the other, each row-major with leading dimension B, so
+  a tile kernel streams its three tiles linearly. rows[] is not valid
+  while the matrix is blocked.
+
+  matrix_zorder() stores the tiles in Morton (Z) order instead, so every
+  quadrant, quadrant of a quadrant and so on down to one tile is one
+  contiguous block. N/B must be a power of two. TILE() does not apply.
+*/
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h>
+
+#define MATRIX_ALIGN 64
+
+typedef struct {
+     int N;
+     int ld;         /* ints between rows in row-major form */
+     int B;          /* tile size when blocked, 0 when row-major */
+     int zorder;     /* blocked tiles are in Morton order */
+     int *data;
+     int **rows;
+} matrix;
+
+/* element (i,j) of a row-major matrix */
+#define MAT(m,i,j) ((m)->data[(size_t)(i)*(m)->ld+(j)])
+
+/* first element of the tile holding element (I,J) of a blocked matrix */
+#define TILE(m,I,J) ((m)->data+((size_t)((I)/(m)->B)*((m)->N/(m)->B)+(J)/(m)->B)*(m)->B*(m)->B)
+
+/* element (i,j) of a blocked matrix */
+#define BMAT(m,i,j) (TILE(m,i,j)[(size_t)((i)%(m)->B)*(m)->B+(j)%(m)->B])
+
+matrix *matrix_alloc(int N);
+void matrix_free(matrix *m);
+void matrix_block(matrix *m, int B);
+void matrix_zorder(matrix *m, int B);
+void matrix_unblock(matrix *m);
+
+#endif
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <immintrin.h>
+#include "minplus.h"
+
+typedef void (*tile_kernel)(int *C, const int *X, const int *Y, int B);
+typedef void (*tile_kernel16)(dist16 *C, const dist16 *X, const dist16 *Y, int B);
+
+static void kij_scalar(int *C, const int *X, const int *Y, int B)
+{
+     int i, j, k, x;
+
+     for(k=0; k<B; k++)
+        for(i=0; i<B; i++) {
+           x = X[i*B+k];
+           for(j=0; j<B; j++)
+              C[i*B+j] = C[i*B+j] < x+Y[k*B+j] ? C[i*B+j] : x+Y[k*B+j];
+        }
+}
+
+static void kij16_scalar(dist16 *C, const dist16 *X, const dist16 *Y, int B)
+{
+     int i, j, k, x, s;
+
+     for(k=0; k<B; k++)
+        for(i=0; i<B; i++) {
+           x = X[i*B+k];
+           for(j=0; j<B; j++) {
+              s = x+Y[k*B+j];
+              s = s < DIST16_MAX ? s : DIST16_MAX;
+              C[i*B+j] = C[i*B+j] < s ? C[i*B+j] : s;
+           }
+        }
+}
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define ELEM int
+#define VEC __m256i
+#define W 8
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE(p,v) _mm256_storeu_si256((__m256i *)(p), v)
+#define MIN _mm256_min_epi32
+#define ADD _mm256_add_epi32
+#define SET1 _mm256_set1_epi32
+#define KERNEL(name) name##_avx2
+#include "minplus_body.h"
+
+/* 16-bit distances, saturating at DIST16_MAX */
+#define ELEM dist16
+#define VEC __m256i
+#define W 16
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE(p,v) _mm256_storeu_si256((__m256i *)(p), v)
+#define MIN _mm256_min_epu16
+#define ADD _mm256_adds_epu16
+#define SET1 _mm256_set1_epi16
+#define KERNEL(name) name##16_avx2
+#include "minplus_body.h"
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#define ELEM int
+#define VEC __m512i
+#define W 16
+#define LOAD(p) _mm512_loadu_si512(p)
+#define STORE(p,v) _mm512_storeu_si512(p, v)
+#define MIN _mm512_min_epi32
+#define ADD _mm512_add_epi32
+#define SET1 _mm512_set1_epi32
+#define KERNEL(name) name##_avx512
+#include "minplus_body.h"
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw")
+#define ELEM dist16
+#define VEC __m512i
+#define W 32
+#define LOAD(p) _mm512_loadu_si512(p)
+#define STORE(p,v) _mm512_storeu_si512(p, v)
+#define MIN _mm512_min_epu16
+#define ADD _mm512_adds_epu16
+#define SET1 _mm512_set1_epi16
+#define KERNEL(name) name##16_avx512
+#include "minplus_body.h"
+#pragma GCC pop_options
+
+/*
+  Path tracking: step k of C = min(C, X[.][k] + Y[k][.]), and where it
+  improves Cn = Xn[.][k].
+*/
+static void kij_path_scalar(int *C, hop *Cn, const int *X, const hop *Xn, const int *Y, int B)
+{
+     int i, j, k, x;
+     hop xn;
+
+     for(k=0; k<B; k++)
+        for(i=0; i<B; i++) {
+           x = X[i*B+k];
+           xn = Xn[i*B+k];
+           for(j=0; j<B; j++)
+              if (x+Y[k*B+j] < C[i*B+j]) {
+                 C[i*B+j] = x+Y[k*B+j];
+                 Cn[i*B+j] = xn;
+              }
+        }
+}
+
+__attribute__((target("avx2")))
+static void kij_path_avx2(int *C, hop *Cn, const int *X, const hop *Xn, const int *Y, int B)
+{
+     __m256i x, s, c, less;
+     __m128i xn, mask;
+     int i, j, k;
+
+     for(k=0; k<B; k++)
+        for(i=0; i<B; i++) {
+           x = _mm256_set1_epi32(X[i*B+k]);
+           xn = _mm_set1_epi16(Xn[i*B+k]);
+           for(j=0; j<B; j+=8) {
+              s = _mm256_add_epi32(x, _mm256_loadu_si256((const __m256i *)(Y+k*B+j)));
+              c = _mm256_loadu_si256((const __m256i *)(C+i*B+j));
+              less = _mm256_cmpgt_epi32(c, s);
+              _mm256_storeu_si256((__m256i *)(C+i*B+j), _mm256_min_epi32(c, s));
+              /* 32-bit lane masks to 16-bit ones */
+              mask = _mm_packs_epi32(_mm256_castsi256_si128(less), _mm256_extracti128_si256(less, 1));
+              _mm_storeu_si128((__m128i *)(Cn+i*B+j),
+                               _mm_blendv_epi8(_mm_loadu_si128((const __m128i *)(Cn+i*B+j)), xn, mask));
+           }
+        }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void kij_path_avx512(int *C, hop *Cn, const int *X, const hop *Xn, const int *Y, int B)
+{
+     __m512i x, s;
+     __m256i xn;
+     __mmask16 less;
+     int i, j, k;
+
+     for(k=0; k<B; k++)
+        for(i=0; i<B; i++) {
+           x = _mm512_set1_epi32(X[i*B+k]);
+           xn = _mm256_set1_epi16(Xn[i*B+k]);
+           for(j=0; j<B; j+=16) {
+              s = _mm512_add_epi32(x, _mm512_loadu_si512(Y+k*B+j));
+              less = _mm512_cmplt_epi32_mask(s, _mm512_loadu_si512(C+i*B+j));
+              /* only the improved entries are written */
+              _mm512_mask_storeu_epi32(C+i*B+j, less, s);
+              _mm256_mask_storeu_epi16(Cn+i*B+j, less, xn);
+           }
+        }
+}
+
+/* inner tiles: 4 rows x 32 columns of C and Cn in registers over all k */
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void inner_path_avx512(int *C, hop *Cn, const int *X, const hop *Xn, const int *Y, int B)
+{
+     __m512i c[4][2], y[2], x, s;
+     __m256i n[4][2], xn;
+     __mmask16 less;
+     int i, j, k, r, v;
+
+     for(i=0; i<B; i+=4)
+        for(j=0; j<B; j+=32) {
+           for(r=0; r<4; r++)
+              for(v=0; v<2; v++) {
+                 c[r][v] = _mm512_loadu_si512(C+(i+r)*B+j+16*v);
+                 n[r][v] = _mm256_loadu_si256((const __m256i *)(Cn+(i+r)*B+j+16*v));
+              }
+           for(k=0; k<B; k++) {
+              y[0] = _mm512_loadu_si512(Y+k*B+j);
+              y[1] = _mm512_loadu_si512(Y+k*B+j+16);
+              for(r=0; r<4; r++) {
+                 x = _mm512_set1_epi32(X[(i+r)*B+k]);
+                 xn = _mm256_set1_epi16(Xn[(i+r)*B+k]);
+                 for(v=0; v<2; v++) {
+                    s = _mm512_add_epi32(x, y[v]);
+                    less = _mm512_cmplt_epi32_mask(s, c[r][v]);
+                    c[r][v] = _mm512_mask_mov_epi32(c[r][v], less, s);
+                    n[r][v] = _mm256_mask_mov_epi16(n[r][v], less, xn);
+                 }
+              }
+           }
+           for(r=0; r<4; r++)
+              for(v=0; v<2; v++) {
+                 _mm512_storeu_si512(C+(i+r)*B+j+16*v, c[r][v]);
+                 _mm256_storeu_si256((__m256i *)(Cn+(i+r)*B+j+16*v), n[r][v]);
+              }
+        }
+}
+
+static int has_avx2, has_avx512, has_avx512bw;
+
+void minplus_init(void)
+{
+     __builtin_cpu_init();
+     has_avx2 = __builtin_cpu_supports("avx2");
+     has_avx512 = __builtin_cpu_supports("avx512f");
+     has_avx512bw = has_avx512 && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+     fprintf(stderr, "minplus: using %s kernels\n",
+             has_avx512 ? "avx512" : has_avx2 ? "avx2" : "scalar");
+}
+
+/* the widest vectors that fill the tile rows, scalar code if none do */
+static tile_kernel pick(int inner, int B)
+{
+     if (has_avx512 && B % 16 == 0)
+        return inner ? inner_avx512 : kij_avx512;
+     if (has_avx2 && B % 8 == 0)
+        return inner ? inner_avx2 : kij_avx2;
+     return kij_scalar;
+}
+
+void minplus_diag(int *Akk, int B)
+{
+     pick(0, B)(Akk, Akk, Akk, B);
+}
+
+void minplus_row(int *Akj, const int *Akk, int B)
+{
+     pick(0, B)(Akj, Akk, Akj, B);
+}
+
+void minplus_col(int *Aik, const int *Akk, int B)
+{
+     pick(0, B)(Aik, Aik, Akk, B);
+}
+
+void minplus_inner(int *Aij, const int *Aik, const int *Akj, int B)
+{
+     pick(1, B)(Aij, Aik, Akj, B);
+}
+
+static tile_kernel16 pick16(int inner, int B)
+{
+     if (has_avx512bw && B % 32 == 0)
+        return inner ? inner16_avx512 : kij16_avx512;
+     if (has_avx2 && B % 16 == 0)
+        return inner ? inner16_avx2 : kij16_avx2;
+     return kij16_scalar;
+}
+
+void minplus16_diag(dist16 *Akk, int B)
+{
+     pick16(0, B)(Akk, Akk, Akk, B);
+}
+
+void minplus16_row(dist16 *Akj, const dist16 *Akk, int B)
+{
+     pick16(0, B)(Akj, Akk, Akj, B);
+}
+
+void minplus16_col(dist16 *Aik, const dist16 *Akk, int B)
+{
+     pick16(0, B)(Aik, Aik, Akk, B);
+}
+
+void minplus16_inner(dist16 *Aij, const dist16 *Aik, const dist16 *Akj, int B)
+{
+     pick16(1, B)(Aij, Aik, Akj, B);
+}
+
+typedef void (*path_kernel)(int *C, hop *Cn, const int *X, const hop *Xn, const int *Y, int B);
+
+static path_kernel pick_path(int inner, int B)
+{
+     if (inner && has_avx512bw && B % 32 == 0)
+        return inner_path_avx512;
+     if (has_avx512bw && B % 16 == 0)
+        return kij_path_avx512;
+     if (has_avx2 && B % 8 == 0)
+        return kij_path_avx2;
+     return kij_path_scalar;
+}
+
+void minplus_diag_path(int *Akk, hop *Nkk, int B)
+{
+     pick_path(0, B)(Akk, Nkk, Akk, Nkk, Akk, B);
+}
+
+void minplus_row_path(int *Akj, hop *Nkj, const int *Akk, const hop *Nkk, int B)
+{
+     pick_path(0, B)(Akj, Nkj, Akk, Nkk, Akj, B);
+}
+
+void minplus_col_path(int *Aik, hop *Nik, const int *Akk, int B)
+{
+     pick_path(0, B)(Aik, Nik, Aik, Nik, Akk, B);
+}
+
+void minplus_inner_path(int *Aij, hop *Nij, const int *Aik, const hop *Nik, const int *Akj, int B)
+{
+     pick_path(1, B)(Aij, Nij, Aik, Nik, Akj, B);
+}
+
+void fw_classic(matrix *A)
+{
+     int N = A->N;
+     int i, j, k, aik;
+
+     for(k=0; k<N; k++)
+        for(i=0; i<N; i++) {
+           aik = MAT(A,i,k);
+           for(j=0; j<N; j++)
+              if (aik + MAT(A,k,j) < MAT(A,i,j))
+                 MAT(A,i,j) = aik + MAT(A,k,j);
+        }
+}
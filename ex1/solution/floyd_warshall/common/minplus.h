@@ -0,0 +1,56 @@
+/*
+  Min-plus tile kernels for the blocked Floyd-Warshall drivers.
+
+  All tiles are B x B, contiguous, leading dimension B (see matrix.h),
+  and every kernel computes C[i][j] = min(C[i][j], X[i][k] + Y[k][j]) for
+  the k of the pivot tile. The four tile kinds of one round differ in
+  which of C, X and Y are the same tile, and so in their dependences:
+
+    diag   C = X = Y = A[K][K]   k must stay the outer loop
+    row    C = Y = A[K][J]       X = A[K][K] is final, k still outer
+    col    C = X = A[I][K]       Y = A[K][K] is final, k still outer
+    inner  C = A[I][J]           X and Y are final, so k can run inside
+                                 a register block of C
+
+  For the first three, X[i][k] and Y[k][j] do not change during step k as
+  the diagonal is >= 0, so each step is vectorized over j with X[i][k]
+  broadcast. minplus_init() picks AVX-512, AVX2 or scalar code at run
+  time; the vector code needs B to be a multiple of 16 or 8.
+
+  The _path variants also keep the next-hop tiles of paths.h up to date.
+
+  The minplus16 kernels work on 16-bit distances with saturating adds:
+  any length of DIST16_MAX or more is stored as DIST16_MAX, all shorter
+  ones are exact. Twice as many of them fit a cache line or a vector, the
+  vector code needs B to be a multiple of 32 or 16.
+*/
+#ifndef MINPLUS_H
+#define MINPLUS_H
+
+#include "matrix.h"
+#include "paths.h"
+
+typedef uint16_t dist16;
+
+#define DIST16_MAX 0xffff
+
+void minplus_init(void);
+void minplus_diag(int *Akk, int B);
+void minplus_row(int *Akj, const int *Akk, int B);
+void minplus_col(int *Aik, const int *Akk, int B);
+void minplus_inner(int *Aij, const int *Aik, const int *Akj, int B);
+
+void minplus_diag_path(int *Akk, hop *Nkk, int B);
+void minplus_row_path(int *Akj, hop *Nkj, const int *Akk, const hop *Nkk, int B);
+void minplus_col_path(int *Aik, hop *Nik, const int *Akk, int B);
+void minplus_inner_path(int *Aij, hop *Nij, const int *Aik, const hop *Nik, const int *Akj, int B);
+
+void minplus16_diag(dist16 *Akk, int B);
+void minplus16_row(dist16 *Akj, const dist16 *Akk, int B);
+void minplus16_col(dist16 *Aik, const dist16 *Akk, int B);
+void minplus16_inner(dist16 *Aij, const dist16 *Aik, const dist16 *Akj, int B);
+
+/* the classic triple loop on a row-major matrix, for checking results */
+void fw_classic(matrix *A);
+
+#endif
@@ -0,0 +1,77 @@
+/*
+  Min-plus kernels for one element type and vector width, included by
+  minplus.c once per variant with ELEM, VEC, W, LOAD, STORE, MIN, ADD,
+  SET1 and KERNEL(name) defined. They are undefined again at the end.
+*/
+
+/* step k of C = min(C, X[.][k] + Y[k][.]), four rows at a time */
+static void KERNEL(kij)(ELEM *C, const ELEM *X, const ELEM *Y, int B)
+{
+     VEC x0, x1, x2, x3, y;
+     int i, j, k;
+
+     for(k=0; k<B; k++)
+        for(i=0; i<B; i+=4) {
+           x0 = SET1(X[(i+0)*B+k]);
+           x1 = SET1(X[(i+1)*B+k]);
+           x2 = SET1(X[(i+2)*B+k]);
+           x3 = SET1(X[(i+3)*B+k]);
+           for(j=0; j<B; j+=W) {
+              y = LOAD(Y+k*B+j);
+              STORE(C+(i+0)*B+j, MIN(LOAD(C+(i+0)*B+j), ADD(x0, y)));
+              STORE(C+(i+1)*B+j, MIN(LOAD(C+(i+1)*B+j), ADD(x1, y)));
+              STORE(C+(i+2)*B+j, MIN(LOAD(C+(i+2)*B+j), ADD(x2, y)));
+              STORE(C+(i+3)*B+j, MIN(LOAD(C+(i+3)*B+j), ADD(x3, y)));
+           }
+        }
+}
+
+/* rows i..i+3, V vectors from column j, kept in registers over all k */
+static inline __attribute__((always_inline)) void KERNEL(block)(ELEM *C, const ELEM *X,
+          const ELEM *Y, int B, int i, int j, const int V)
+{
+     VEC c[4][4], y[4], x;
+     int r, v, k;
+
+     for(r=0; r<4; r++)
+        for(v=0; v<V; v++)
+           c[r][v] = LOAD(C+(i+r)*B+j+v*W);
+     for(k=0; k<B; k++) {
+        for(v=0; v<V; v++)
+           y[v] = LOAD(Y+k*B+j+v*W);
+        for(r=0; r<4; r++) {
+           x = SET1(X[(i+r)*B+k]);
+           for(v=0; v<V; v++)
+              c[r][v] = MIN(c[r][v], ADD(x, y[v]));
+        }
+     }
+     for(r=0; r<4; r++)
+        for(v=0; v<V; v++)
+           STORE(C+(i+r)*B+j+v*W, c[r][v]);
+}
+
+static void KERNEL(inner)(ELEM *C, const ELEM *X, const ELEM *Y, int B)
+{
+     int i, j;
+
+     for(i=0; i<B; i+=4) {
+        for(j=0; j+4*W<=B; j+=4*W)
+           KERNEL(block)(C, X, Y, B, i, j, 4);
+        if(j+2*W<=B) {
+           KERNEL(block)(C, X, Y, B, i, j, 2);
+           j+=2*W;
+        }
+        if(j<B)
+           KERNEL(block)(C, X, Y, B, i, j, 1);
+     }
+}
+
+#undef ELEM
+#undef VEC
+#undef W
+#undef LOAD
+#undef STORE
+#undef MIN
+#undef ADD
+#undef SET1
+#undef KERNEL
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "paths.h"
+
+hop *paths_alloc(const matrix *A)
+{
+     size_t size = A->B ? (size_t)A->N*A->N : (size_t)A->N*A->ld;
+     hop *next;
+     int i, j;
+
+     if (A->N > PATHS_MAX_N) {
+        fprintf(stderr, "paths: N=%d does not fit 16-bit hops\n", A->N);
+        exit(-1);
+     }
+     next = aligned_alloc(MATRIX_ALIGN, (size*sizeof(hop)+MATRIX_ALIGN-1)/MATRIX_ALIGN*MATRIX_ALIGN);
+     if (next == NULL) {
+        fprintf(stderr, "Error in allocation\n");
+        exit(-1);
+     }
+     #pragma omp parallel for private(j)
+     for(i=0; i<A->N; i++)
+        for(j=0; j<A->N; j++)
+           NEXT(A,next,i,j) = j;
+     return next;
+}
+
+size_t paths_offset(const matrix *A, int i, int j)
+{
+     if (A->B == 0)
+        return (size_t)i*A->ld + j;
+     return &BMAT(A,i,j) - A->data;
+}
+
+int paths_query(const matrix *A, const hop *next, int i, int j, int *path)
+{
+     int n = 0;
+
+     path[n++] = i;
+     while (i != j && n < A->N) {
+        i = NEXT(A,next,i,j);
+        path[n++] = i;
+     }
+     return n;
+}
@@ -0,0 +1,29 @@
+/*
+  Next-hop matrix for path reconstruction.
+
+  next[i][j] is the vertex after i on the shortest path from i to j,
+  initially j itself. It is stored as 16-bit indices in the same layout
+  as the matrix it belongs to (row-major or blocked, see matrix.h), so it
+  adds half the traffic of the distances and only works for N < 65536.
+  Whenever a kernel shortens A[i][j] through k it copies next[i][k].
+*/
+#ifndef PATHS_H
+#define PATHS_H
+
+#include <stdint.h>
+#include "matrix.h"
+
+typedef uint16_t hop;
+
+#define PATHS_MAX_N 65535
+
+/* element (i,j) of next, laid out like A */
+#define NEXT(A,next,i,j) ((next)[paths_offset(A,i,j)])
+
+hop *paths_alloc(const matrix *A);
+size_t paths_offset(const matrix *A, int i, int j);
+
+/* writes the vertices from i to j into path (room for N), returns their count */
+int paths_query(const matrix *A, const hop *next, int i, int j, int *path);
+
+#endif
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "sparse.h"
+
+/*
+  Cost of one Dijkstra edge relaxation and of one vertex (pop, bucket
+  moves, row init) in units of one FW min-plus cell update of the vector
+  tile kernels, fitted from single-thread AVX-512 runs at N=4096 with
+  average degree 4 and 118.
+*/
+#define EDGE_COST 135
+#define VERTEX_COST 2350
+
+typedef struct {
+     int dist, v;
+} heap_entry;
+
+int sparse_no_edge(const matrix *A)
+{
+     int N = A->N, max = INT_MIN, i, j;
+     long count = 0;
+
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++)
+           if (MAT(A,i,j) > max) {
+              max = MAT(A,i,j);
+              count = 1;
+           }
+           else if (MAT(A,i,j) == max)
+              count++;
+     return count > N ? max : INT_MAX;
+}
+
+csr *csr_from_matrix(const matrix *A, int no_edge)
+{
+     csr *G = malloc(sizeof(csr));
+     int N = A->N, i, j;
+     long e;
+
+     G->N = N;
+     G->start = malloc((N+1)*sizeof(long));
+     G->start[0] = 0;
+     for(i=0; i<N; i++) {
+        for(e=0, j=0; j<N; j++)
+           e += i != j && MAT(A,i,j) != no_edge;
+        G->start[i+1] = G->start[i] + e;
+     }
+     G->E = G->start[N];
+     G->to = malloc(G->E*sizeof(int));
+     G->weight = malloc(G->E*sizeof(int));
+     if (G->to == NULL || G->weight == NULL) {
+        fprintf(stderr, "Error in allocation\n");
+        exit(-1);
+     }
+     #pragma omp parallel for private(j, e)
+     for(i=0; i<N; i++)
+        for(e=G->start[i], j=0; j<N; j++)
+           if (i != j && MAT(A,i,j) != no_edge) {
+              G->to[e] = j;
+              G->weight[e++] = MAT(A,i,j);
+           }
+     return G;
+}
+
+void csr_free(csr *G)
+{
+     free(G->start);
+     free(G->to);
+     free(G->weight);
+     free(G);
+}
+
+/*
+  Radix heap: keys never drop below the last popped one, so an entry
+  goes to bucket (highest bit in which it differs from last) + 1, 0 for
+  equal. Popping refills bucket 0 from the first non-empty bucket, every
+  entry moves down at most 32 times in all.
+*/
+#define BUCKETS 33
+
+typedef struct {
+     heap_entry *e[BUCKETS];
+     long n[BUCKETS], size[BUCKETS];
+     unsigned last;
+     long count;
+} radix_heap;
+
+static inline int bucket(const radix_heap *h, unsigned key)
+{
+     return key == h->last ? 0 : 32 - __builtin_clz(key ^ h->last);
+}
+
+static inline void heap_push(radix_heap *h, int dist, int v)
+{
+     int b = bucket(h, dist);
+
+     if (h->n[b] == h->size[b]) {
+        h->size[b] = h->size[b] ? 2*h->size[b] : 256;
+        h->e[b] = realloc(h->e[b], h->size[b]*sizeof(heap_entry));
+     }
+     h->e[b][h->n[b]].dist = dist;
+     h->e[b][h->n[b]++].v = v;
+     h->count++;
+}
+
+static inline heap_entry heap_pop(radix_heap *h)
+{
+     int b, t;
+     long i;
+     unsigned min;
+
+     if (h->n[0] == 0) {
+        for(b=1; h->n[b] == 0; b++)
+           ;
+        for(min=h->e[b][0].dist, i=1; i<h->n[b]; i++)
+           if ((unsigned)h->e[b][i].dist < min)
+              min = h->e[b][i].dist;
+        h->last = min;
+        for(i=0; i<h->n[b]; i++) {
+           t = bucket(h, h->e[b][i].dist);
+           if (h->n[t] == h->size[t]) {
+              h->size[t] = h->size[t] ? 2*h->size[t] : 256;
+              h->e[t] = realloc(h->e[t], h->size[t]*sizeof(heap_entry));
+           }
+           h->e[t][h->n[t]++] = h->e[b][i];
+        }
+        h->n[b] = 0;
+     }
+     h->count--;
+     return h->e[0][--h->n[0]];
+}
+
+void apsp_dijkstra(const csr *G, matrix *D, int no_edge)
+{
+     int N = G->N, s;
+
+     #pragma omp parallel
+     {
+        radix_heap heap = { { NULL } };
+        int u, v, d, b;
+        long e;
+        heap_entry top;
+
+        #pragma omp for schedule(dynamic,4)
+        for(s=0; s<N; s++) {
+           int *dist = &MAT(D,s,0);
+
+           for(v=0; v<N; v++)
+              dist[v] = no_edge;
+           dist[s] = 0;
+           heap.last = 0;
+           heap_push(&heap, 0, s);
+           while (heap.count > 0) {
+              top = heap_pop(&heap);
+              u = top.v;
+              if (top.dist > dist[u])
+                 continue;
+              for(e=G->start[u]; e<G->start[u+1]; e++) {
+                 v = G->to[e];
+                 d = top.dist + G->weight[e];
+                 if (d < dist[v]) {
+                    dist[v] = d;
+                    heap_push(&heap, d, v);
+                 }
+              }
+           }
+        }
+        for(b=0; b<BUCKETS; b++)
+           free(heap.e[b]);
+     }
+}
+
+int sparse_preferred(int N, long E)
+{
+     /* per source: Dijkstra against N^2 FW cell updates */
+     return (double)EDGE_COST*E + (double)VERTEX_COST*N < (double)N*N;
+}
@@ -0,0 +1,38 @@
+/*
+  All-pairs shortest paths on a sparse graph: one Dijkstra per source
+  over a CSR copy of the adjacency matrix.
+
+  An entry of the matrix counts as an edge unless it holds the "no edge"
+  value, which sparse_no_edge() guesses as the largest weight when that
+  is used for more than N entries (graph_init_random style sentinels);
+  otherwise every entry is an edge. Distances that would reach no_edge
+  are stored as no_edge, which is what FW leaves in those entries too.
+
+  apsp_dijkstra() writes row s of the row-major result from source s;
+  sources are handed out to the threads in small dynamic chunks. The
+  queue is a radix heap, per thread and reused across sources; stale
+  entries are skipped when popped.
+
+  sparse_preferred() is the density heuristic: per source, Dijkstra's
+  cost per edge and per vertex against the N^2 cell updates FW spends.
+*/
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include "matrix.h"
+
+typedef struct {
+     int N;
+     long E;
+     long *start;    /* edges of u are start[u] .. start[u+1]-1 */
+     int *to;
+     int *weight;
+} csr;
+
+int sparse_no_edge(const matrix *A);
+csr *csr_from_matrix(const matrix *A, int no_edge);
+void csr_free(csr *G);
+void apsp_dijkstra(const csr *G, matrix *D, int no_edge);
+int sparse_preferred(int N, long E);
+
+#endif
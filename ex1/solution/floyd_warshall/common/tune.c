@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+#include "tune.h"
+
+#define DEFAULT_L2 (1L << 20)
+
+/* L2 size from sysconf, sysfs when glibc does not know it */
+static long l2_size(void)
+{
+     long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+     FILE *f;
+     char unit = 0;
+
+     if (size > 0)
+        return size;
+     f = fopen("/sys/devices/system/cpu/cpu0/cache/index2/size", "r");
+     if (f == NULL)
+        return DEFAULT_L2;
+     if (fscanf(f, "%ld%c", &size, &unit) < 1 || size <= 0)
+        size = DEFAULT_L2;
+     else if (unit == 'K')
+        size <<= 10;
+     else if (unit == 'M')
+        size <<= 20;
+     fclose(f);
+     return size;
+}
+
+static const char *tune_file(void)
+{
+     const char *path = getenv("FW_TUNE_FILE");
+
+     return path ? path : "fw_tune.txt";
+}
+
+static int lookup(const char *driver, int lo, int maxthreads, int *B, int *threads)
+{
+     FILE *f = fopen(tune_file(), "r");
+     char name[64];
+     int n, m, b, t, found = 0;
+     double s;
+
+     if (f == NULL)
+        return 0;
+     /* the last matching line wins */
+     while (fscanf(f, "%63s %d %d %d %d %lf", name, &n, &m, &b, &t, &s) == 6)
+        if (strcmp(name, driver) == 0 && n == lo && m == maxthreads) {
+           *B = b;
+           *threads = t;
+           found = 1;
+        }
+     fclose(f);
+     return found;
+}
+
+int tune_tile(const char *driver, int N, tune_trial trial, void *arg)
+{
+     int maxthreads = omp_get_max_threads();
+     int lo = 1, B, t, best_B = 0, best_t = 1;
+     long l2 = l2_size();
+     double s, again, best = 0;
+     FILE *f;
+
+     while (2*lo <= N)
+        lo *= 2;
+     if (lookup(driver, lo, maxthreads, &best_B, &best_t) && N % best_B == 0) {
+        omp_set_num_threads(best_t);
+        fprintf(stderr, "tune: %s N %d B %d threads %d from %s\n", driver, N, best_B, best_t, tune_file());
+        return best_B;
+     }
+
+     for(B=16; B<=N && 3L*B*B*(long)sizeof(int) <= l2; B*=2) {
+        if (N % B != 0)
+           continue;
+        for(t=1; ; t = 2*t < maxthreads ? 2*t : maxthreads) {
+           omp_set_num_threads(t);
+           /* the better of two, the first one also warms up */
+           s = trial(B, arg);
+           again = trial(B, arg);
+           s = again < s ? again : s;
+           fprintf(stderr, "tune: %s N %d B %d threads %d %g s\n", driver, N, B, t, s);
+           if (best_B == 0 || s < best) {
+              best = s;
+              best_B = B;
+              best_t = t;
+           }
+           if (t == maxthreads)
+              break;
+        }
+     }
+     if (best_B == 0) {
+        fprintf(stderr, "tune: no tile size from 16 up divides N=%d\n", N);
+        exit(-1);
+     }
+     omp_set_num_threads(best_t);
+
+     f = fopen(tune_file(), "a");
+     if (f != NULL) {
+        fprintf(f, "%s %d %d %d %d %g\n", driver, lo, maxthreads, best_B, best_t, best);
+        fclose(f);
+     }
+     fprintf(stderr, "tune: %s N %d B %d threads %d\n", driver, N, best_B, best_t);
+     return best_B;
+}
@@ -0,0 +1,24 @@
+/*
+  Tile size and thread count auto-tuning.
+
+  tune_tile() picks B for a driver: power-of-two tiles that divide N,
+  from 16 up to the largest whose three tiles still fit the L2 cache, are
+  each timed on every power-of-two thread count with a short trial of
+  the driver's real kernel, and the fastest pair wins. The thread count
+  is applied with omp_set_num_threads.
+
+  Choices are kept in a tuning file (FW_TUNE_FILE, default fw_tune.txt),
+  one line per driver, range of N (powers of two, [lo, 2*lo)) and number
+  of available threads:
+    driver Nlo maxthreads B threads seconds
+  Later runs that match a line reuse it without trials.
+*/
+#ifndef TUNE_H
+#define TUNE_H
+
+/* seconds per unit of work for tile size B on the current thread count */
+typedef double (*tune_trial)(int B, void *arg);
+
+int tune_tile(const char *driver, int N, tune_trial trial, void *arg);
+
+#endif
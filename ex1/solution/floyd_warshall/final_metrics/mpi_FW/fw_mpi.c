@@ -0,0 +1,318 @@
+/*
+  Blocked Floyd-Warshall over MPI.
+  command-line arguments: N, B, Px, Py
+  N = size of graph
+  B = size of tile
+  Px x Py = process grid, Px*Py processes
+  works only when N is a multiple of B
+  compile: mpicc -O3 -fopenmp fw_mpi.c ../../common/matrix.c ../../common/minplus.c
+  add -DVERIFY to gather the result on rank 0 and check it against the
+  classic algorithm (the whole matrix then has to fit on rank 0)
+
+  The N/B x N/B tiles are dealt out 2D block-cyclically: tile (I,J) lives
+  on process (I mod Px, J mod Py) of a Cartesian communicator, as in
+  jacobi_mpi.c. In round K the owner of the diagonal tile updates it and
+  broadcasts it along its process row and column, those update the pivot
+  row and column panels, and the panels are broadcast down the process
+  columns and along the process rows, where every process updates its
+  remaining tiles.
+
+  Rounds are pipelined one deep: once the panels of round K have arrived,
+  a process first updates its tiles of tile row and column K+1, starts
+  round K+1 (diagonal, panels and the nonblocking broadcast of the new
+  panels), and only then updates the rest of its round K tiles while the
+  round K+1 panels travel.
+
+  The graph is generated tile by tile from a hash of (i,j), so no process
+  ever holds more than its own share and the graph does not depend on
+  the process grid. On average it has 128*N edges like graph_init_random.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <omp.h>
+#include "mpi.h"
+#include "../../common/matrix.h"
+#include "../../common/minplus.h"
+
+#define INF (1<<28)
+
+typedef struct {
+     int N, B, NT;         /* graph size, tile size, tiles per dimension */
+     int grid[2], coords[2];
+     int nI, nJ;           /* local tile rows and columns */
+     int *tiles;           /* local tiles, nI x nJ of B x B */
+     int *diag;            /* diagonal tile of the current round */
+     int *row[2], *col[2]; /* pivot panels, double buffered by round */
+     MPI_Comm row_comm, col_comm;
+     MPI_Request panels[2];
+     double tcomp, tcomm;
+} fw_dist;
+
+static double now(void)
+{
+     struct timeval t;
+
+     gettimeofday(&t,0);
+     return t.tv_sec+t.tv_usec*0.000001;
+}
+
+static uint64_t mix(uint64_t x)
+{
+     x+=0x9e3779b97f4a7c15ULL;
+     x=(x^(x>>30))*0xbf58476d1ce4e5b9ULL;
+     x=(x^(x>>27))*0x94d049bb133111ebULL;
+     return x^(x>>31);
+}
+
+/* weight of edge (i,j), INF if there is none */
+static int edge(int N, int i, int j)
+{
+     uint64_t h;
+
+     if(i==j) return 0;
+     h=mix((uint64_t)i*N+j);
+     if(h%N>=128) return INF;
+     return 1+(h>>32)%1000;
+}
+
+/* local tile of global tile (I,J), which must be ours */
+/* n ints, the size rounded up to whole MATRIX_ALIGN blocks as aligned_alloc wants */
+static int *alloc_ints(size_t n)
+{
+     int *p=aligned_alloc(MATRIX_ALIGN, (n*sizeof(int)+MATRIX_ALIGN-1)/MATRIX_ALIGN*MATRIX_ALIGN);
+
+     if(p==NULL) {
+        fprintf(stderr, "Error in allocation\n");
+        MPI_Abort(MPI_COMM_WORLD,-1);
+     }
+     return p;
+}
+
+static int *tile(fw_dist *d, int I, int J)
+{
+     return d->tiles+((size_t)(I/d->grid[0])*d->nJ+J/d->grid[1])*d->B*d->B;
+}
+
+static int owns_row(fw_dist *d, int I) { return I%d->grid[0]==d->coords[0]; }
+static int owns_col(fw_dist *d, int J) { return J%d->grid[1]==d->coords[1]; }
+
+/*
+  Diagonal and panels of round K, then start broadcasting the panels.
+  Tile row and column K must already be final for round K-1.
+*/
+static void start_round(fw_dist *d, int K)
+{
+     size_t T=(size_t)d->B*d->B;
+     int B=d->B, p=K&1, l;
+     double t;
+
+     t=now();
+     if(owns_row(d,K) && owns_col(d,K)) {
+        minplus_diag(tile(d,K,K), B);
+        memcpy(d->diag, tile(d,K,K), T*sizeof(int));
+     }
+     d->tcomp+=now()-t;
+
+     t=now();
+     if(owns_row(d,K))
+        MPI_Bcast(d->diag, T, MPI_INT, K%d->grid[1], d->row_comm);
+     if(owns_col(d,K))
+        MPI_Bcast(d->diag, T, MPI_INT, K%d->grid[0], d->col_comm);
+     d->tcomm+=now()-t;
+
+     t=now();
+     if(owns_row(d,K)) {
+        #pragma omp parallel for
+        for(l=0; l<d->nJ; l++) {
+           int J=l*d->grid[1]+d->coords[1];
+           if(J!=K)
+              minplus_row(tile(d,K,J), d->diag, B);
+           memcpy(d->row[p]+l*T, tile(d,K,J), T*sizeof(int));
+        }
+     }
+     if(owns_col(d,K)) {
+        #pragma omp parallel for
+        for(l=0; l<d->nI; l++) {
+           int I=l*d->grid[0]+d->coords[0];
+           if(I!=K)
+              minplus_col(tile(d,I,K), d->diag, B);
+           memcpy(d->col[p]+l*T, tile(d,I,K), T*sizeof(int));
+        }
+     }
+     d->tcomp+=now()-t;
+
+     t=now();
+     MPI_Ibcast(d->row[p], d->nJ*T, MPI_INT, K%d->grid[0], d->col_comm, &d->panels[0]);
+     MPI_Ibcast(d->col[p], d->nI*T, MPI_INT, K%d->grid[1], d->row_comm, &d->panels[1]);
+     d->tcomm+=now()-t;
+}
+
+/*
+  Tiles of round K outside the pivot row and column, from the received
+  panels: with lookahead only those in tile row or column next, without
+  it all others.
+*/
+static void update_round(fw_dist *d, int K, int next, int lookahead)
+{
+     size_t T=(size_t)d->B*d->B;
+     int p=K&1, il, jl;
+     double t=now();
+
+     #pragma omp parallel for collapse(2) schedule(dynamic)
+     for(il=0; il<d->nI; il++)
+        for(jl=0; jl<d->nJ; jl++) {
+           int I=il*d->grid[0]+d->coords[0], J=jl*d->grid[1]+d->coords[1];
+           if(I==K || J==K || (I==next || J==next)!=lookahead)
+              continue;
+           minplus_inner(tile(d,I,J), d->col[p]+il*T, d->row[p]+jl*T, d->B);
+        }
+     d->tcomp+=now()-t;
+}
+
+int main(int argc, char **argv)
+{
+     fw_dist d;
+     int rank, size, provided;
+     int periods[2]={0,0}, keep[2];
+     int i, j, il, jl, K;
+     size_t T;
+     MPI_Comm CART_COMM;
+     double ttotal, total_time, comp_time, comm_time, t;
+
+     MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
+     MPI_Comm_size(MPI_COMM_WORLD,&size);
+     MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+     if(provided<MPI_THREAD_FUNNELED) {
+        if(rank==0)
+           fprintf(stderr, "MPI does not support MPI_THREAD_FUNNELED\n");
+        MPI_Abort(MPI_COMM_WORLD,-1);
+     }
+
+     if (argc != 5){
+        fprintf(stderr, "Usage: mpirun .... %s N B Px Py\n", argv[0]);
+        exit(-1);
+     }
+
+     d.N=atoi(argv[1]);
+     d.B=atoi(argv[2]);
+     d.grid[0]=atoi(argv[3]);
+     d.grid[1]=atoi(argv[4]);
+     if(d.B<1 || d.N%d.B!=0 || d.grid[0]*d.grid[1]!=size) {
+        if(rank==0)
+           fprintf(stderr, "N must be a multiple of B and Px*Py the number of processes (%d)\n", size);
+        MPI_Abort(MPI_COMM_WORLD,-1);
+     }
+     d.NT=d.N/d.B;
+     T=(size_t)d.B*d.B;
+
+     //----Create 2D-cartesian communicator and its rows and columns----//
+
+     MPI_Cart_create(MPI_COMM_WORLD,2,d.grid,periods,0,&CART_COMM);
+     MPI_Comm_rank(CART_COMM,&rank);
+     MPI_Cart_coords(CART_COMM,rank,2,d.coords);
+     keep[0]=0; keep[1]=1;
+     MPI_Cart_sub(CART_COMM,keep,&d.row_comm);     /* same process row */
+     keep[0]=1; keep[1]=0;
+     MPI_Cart_sub(CART_COMM,keep,&d.col_comm);     /* same process column */
+
+     //----Local tiles, generated in place----//
+
+     d.nI=(d.NT-d.coords[0]+d.grid[0]-1)/d.grid[0];
+     d.nJ=(d.NT-d.coords[1]+d.grid[1]-1)/d.grid[1];
+     d.tiles=alloc_ints((size_t)d.nI*d.nJ*T+1);
+     d.diag=alloc_ints(T);
+     for(i=0; i<2; i++) {
+        d.row[i]=alloc_ints((size_t)d.nJ*T+1);
+        d.col[i]=alloc_ints((size_t)d.nI*T+1);
+     }
+
+     #pragma omp parallel for private(jl,i,j)
+     for(il=0; il<d.nI; il++)
+        for(jl=0; jl<d.nJ; jl++) {
+           int I=il*d.grid[0]+d.coords[0], J=jl*d.grid[1]+d.coords[1];
+           int *A=tile(&d,I,J);
+           for(i=0; i<d.B; i++)
+              for(j=0; j<d.B; j++)
+                 A[i*d.B+j]=edge(d.N, I*d.B+i, J*d.B+j);
+        }
+
+     minplus_init();
+     d.tcomp=d.tcomm=0;
+
+     //----Computational core----//
+
+     MPI_Barrier(CART_COMM);
+     ttotal=now();
+     start_round(&d,0);
+     for(K=0; K<d.NT; K++) {
+        t=now();
+        MPI_Waitall(2,d.panels,MPI_STATUSES_IGNORE);
+        d.tcomm+=now()-t;
+        if(K+1<d.NT) {
+           update_round(&d,K,K+1,1);
+           start_round(&d,K+1);
+        }
+        update_round(&d,K,K+1,0);
+     }
+     ttotal=now()-ttotal;
+
+     MPI_Reduce(&ttotal,&total_time,1,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
+     MPI_Reduce(&d.tcomp,&comp_time,1,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
+     MPI_Reduce(&d.tcomm,&comm_time,1,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
+
+     if(rank==0)
+        printf("FW_MPI N %d B %d Px %d Py %d ComputationTime %lf CommunicationTime %lf TotalTime %lf processes %d threads %d\n",
+               d.N,d.B,d.grid[0],d.grid[1],comp_time,comm_time,total_time,size,omp_get_max_threads());
+
+#ifdef VERIFY
+     //----Rank 0 gathers the tiles and checks them----//
+
+     if(rank==0) {
+        matrix *R=matrix_alloc(d.N);
+        int *buf=malloc(T*sizeof(int));
+        int src, I, J, errors=0;
+
+        for(i=0; i<d.N; i++)
+           for(j=0; j<d.N; j++) MAT(R,i,j)=edge(d.N,i,j);
+        fw_classic(R);
+        for(I=0; I<d.NT; I++)
+           for(J=0; J<d.NT; J++) {
+              int c[2]={I%d.grid[0], J%d.grid[1]};
+              MPI_Cart_rank(CART_COMM,c,&src);
+              if(src==0)
+                 memcpy(buf, tile(&d,I,J), T*sizeof(int));
+              else
+                 MPI_Recv(buf,T,MPI_INT,src,0,CART_COMM,MPI_STATUS_IGNORE);
+              for(i=0; i<d.B; i++)
+                 for(j=0; j<d.B; j++)
+                    if(buf[i*d.B+j]!=MAT(R,I*d.B+i,J*d.B+j) && errors++==0)
+                       fprintf(stderr,"VERIFY: A[%d][%d]=%d, expected %d\n",I*d.B+i,J*d.B+j,
+                               buf[i*d.B+j],MAT(R,I*d.B+i,J*d.B+j));
+           }
+        fprintf(stderr,errors ? "VERIFY: %d mismatches\n" : "VERIFY: ok\n",errors);
+        free(buf);
+        matrix_free(R);
+     }
+     else
+        for(il=0; il<d.nI; il++)
+           for(jl=0; jl<d.nJ; jl++) {
+              int I=il*d.grid[0]+d.coords[0], J=jl*d.grid[1]+d.coords[1];
+              MPI_Send(tile(&d,I,J),T,MPI_INT,0,0,CART_COMM);
+           }
+#endif
+
+     free(d.tiles);
+     free(d.diag);
+     for(i=0; i<2; i++) {
+        free(d.row[i]);
+        free(d.col[i]);
+     }
+     MPI_Comm_free(&d.row_comm);
+     MPI_Comm_free(&d.col_comm);
+     MPI_Comm_free(&CART_COMM);
+     MPI_Finalize();
+     return 0;
+}
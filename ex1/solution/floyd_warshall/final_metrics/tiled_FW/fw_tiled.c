@@ -1,43 +1,87 @@
 /*
   Tiled version of the Floyd-Warshall algorithm.
-  command-line arguments: N, B
+  command-line arguments: N, B, [paths|dijkstra|auto]
   N = size of graph
-  B = size of tile
+  B = size of tile, or auto to pick it and the thread count (tune.h)
+  paths = also build the next-hop matrix (paths.h), N < 65536
+  dijkstra = run one Dijkstra per source on a CSR copy instead (sparse.h)
+  auto = Dijkstra or tiled FW, whichever the edge density favours
   works only when N is a multiple of B
+  compile: gcc -O3 -fopenmp fw_tiled.c util.c ../../common/matrix.c ../../common/minplus.c ../../common/paths.c ../../common/tune.c ../../common/sparse.c
+  add -DVERIFY to check the result against the classic algorithm
+  add -DNARROW to run on 16-bit saturating distances first, twice as many
+  per cache line and vector; if any distance reaches 65535 the result may
+  be cut off and the 32-bit run is done instead (not with paths)
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
+#include <omp.h>
 #include "util.h"
+#include "../../common/matrix.h"
+#include "../../common/minplus.h"
+#include "../../common/tune.h"
+#include "../../common/sparse.h"
 
-inline int min(int a, int b);
-inline void FW(int **A, int K, int I, int J, int N);
+static inline void FW(matrix *A, int K, int I, int J, int N);
 
-int main(int argc, char **argv)
-{
-     int **A;
-     int i,j,k;
-     struct timeval t1, t2;
-     double time;
-     int B=64;
-     int N=1024;
+static hop *next;      /* next hops, NULL for distances only */
+static dist16 *A16;    /* 16-bit distances in A's layout while they are used */
+static int narrow;     /* the result came from the 16-bit run */
 
-     if (argc != 3){
-        fprintf(stdout, "Usage %s N B\n", argv[0]);
-        exit(0);
-     }
+#define TILE16(A,I,J) (A16+(TILE(A,I,J)-(A)->data))
 
-     N=atoi(argv[1]);
-     B=atoi(argv[2]);
+#ifdef NARROW
+/*
+  Saturated copy of A, 0 if it does not fit or the tiles are narrower
+  than a 16-bit AVX2 vector, where the scalar code would lose.
+*/
+static int narrow_begin(matrix *A)
+{
+     size_t n, size=(size_t)A->N*A->N;
+
+     if(A->B%16!=0)
+        return 0;
+     A16=aligned_alloc(MATRIX_ALIGN, (size*sizeof(dist16)+MATRIX_ALIGN-1)/MATRIX_ALIGN*MATRIX_ALIGN);
+     if(A16==NULL)
+        return 0;
+     #pragma omp parallel for
+     for(n=0; n<size; n++)
+        A16[n]=A->data[n]<DIST16_MAX ? A->data[n] : DIST16_MAX;
+     return 1;
+}
 
-     A=(int **)malloc(N*sizeof(int *));
-     for(i=0; i<N; i++)A[i]=(int *)malloc(N*sizeof(int));
+/*
+  Every distance below DIST16_MAX is exact. If one reached it, it may
+  have been cut off, A is left as it was and 0 returned.
+*/
+static int narrow_end(matrix *A)
+{
+     size_t n, size=(size_t)A->N*A->N;
+     int saturated=0;
 
-     graph_init_random(A,-1,N,128*N);
+     #pragma omp parallel for reduction(|:saturated)
+     for(n=0; n<size; n++)
+        saturated|=A16[n]==DIST16_MAX;
+     if(!saturated) {
+        #pragma omp parallel for
+        for(n=0; n<size; n++)
+           A->data[n]=A16[n];
+        narrow=1;
+     }
+     free(A16);
+     A16=NULL;
+     return !saturated;
+}
+#endif
 
-     gettimeofday(&t1,0);
+/* the rounds with pivots below kend */
+static void rounds(matrix *A, int N, int B, int kend)
+{
+     int i,j,k;
 
-     for(k=0;k<N;k+=B){
+     for(k=0;k<kend;k+=B){
         FW(A,k,k,k,B);
 
         #pragma omp parallel for
@@ -69,32 +113,190 @@ int main(int argc, char **argv)
            for(j=k+B; j<N; j+=B)
               FW(A,k,i,j,B);
      }
+}
+
+/* a few rounds on a copy of the row-major A, seconds per pivot */
+static double trial(int B, void *arg)
+{
+     matrix *A=arg, *T=matrix_alloc(A->N);
+     int N=A->N, i, kend=B*((256+B-1)/B);
+     double t;
+
+     if(kend>N)
+        kend=N;
+     for(i=0; i<N; i++)
+        memcpy(&MAT(T,i,0), &MAT(A,i,0), N*sizeof(int));
+     matrix_block(T,B);
+     t=omp_get_wtime();
+     rounds(T,N,B,kend);
+     t=omp_get_wtime()-t;
+     matrix_free(T);
+     return t/kend;
+}
+
+int main(int argc, char **argv)
+{
+     matrix *A;
+#ifdef VERIFY
+     matrix *R;
+     int j;
+#endif
+     int i;
+     struct timeval t1, t2;
+     double time;
+     int B=64;
+     int N=1024;
+     const char *engine=argc == 4 ? argv[3] : "dense";
+     int sparse=0, no_edge=0;
+     csr *G=NULL;
+
+     if (argc != 3 && !(argc == 4 && (strcmp(engine, "paths") == 0 ||
+         strcmp(engine, "dijkstra") == 0 || strcmp(engine, "auto") == 0))){
+        fprintf(stdout, "Usage %s N B [paths|dijkstra|auto]\n", argv[0]);
+        exit(0);
+     }
+
+     N=atoi(argv[1]);
+     B=atoi(argv[2]);
+
+     A=matrix_alloc(N);
+     minplus_init();
+
+     graph_init_random(A->rows,-1,N,128*N);
+#ifdef VERIFY
+     R=matrix_alloc(N);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++) MAT(R,i,j)=MAT(A,i,j);
+#endif
+     if(strcmp(engine, "dijkstra") == 0 || strcmp(engine, "auto") == 0) {
+        no_edge=sparse_no_edge(A);
+        gettimeofday(&t1,0);
+        G=csr_from_matrix(A,no_edge);
+        sparse=strcmp(engine, "dijkstra") == 0 || sparse_preferred(N,G->E);
+        fprintf(stderr, "%s: %ld edges, average degree %.1f\n", sparse ? "dijkstra" : "tiled FW",
+                G->E, (double)G->E/N);
+        if(!sparse) {
+           csr_free(G);
+           G=NULL;
+        }
+     }
+     if(!sparse) {
+        if(strcmp(argv[2], "auto") == 0)
+           B=tune_tile("fw_tiled", N, trial, A);
+        matrix_block(A,B);
+        if(strcmp(engine, "paths") == 0)
+           next=paths_alloc(A);
+        gettimeofday(&t1,0);
+     }
+
+     if(sparse) {
+        apsp_dijkstra(G,A,no_edge);
+        csr_free(G);
+     }
+     else
+#ifdef NARROW
+     if(!next && narrow_begin(A)) {
+        rounds(A,N,B,N);
+        if(!narrow_end(A)) {
+           fprintf(stderr, "NARROW: distances do not fit 16 bits, rerunning with 32\n");
+           rounds(A,N,B,N);
+        }
+     }
+     else
+#endif
+     rounds(A,N,B,N);
      gettimeofday(&t2,0);
 
      time=(double)((t2.tv_sec-t1.tv_sec)*1000000+t2.tv_usec-t1.tv_usec)/1000000;
-     printf("FW_TILED,%d,%d,%.4f,%d\n", N,B,time, atoi(getenv("OMP_NUM_THREADS")));
+     printf("%s,%d,%d,%.4f,%d\n", sparse ? "APSP_DIJKSTRA" : next ? "FW_TILED_PATHS" :
+            narrow ? "FW_TILED16" : "FW_TILED", N,B,time,
+            omp_get_max_threads());
+
+     if(next) {
+        int *path=malloc(N*sizeof(int));
+        int n=paths_query(A,next,0,N-1,path);
+
+        fprintf(stderr, "path 0 -> %d, length %d:", N-1, BMAT(A,0,N-1));
+        for(i=0; i<n; i++)
+           fprintf(stderr, " %d", path[i]);
+        fprintf(stderr, "\n");
+        free(path);
+     }
 
      /*
+     matrix_unblock(A);
      for(i=0; i<N; i++)
-        for(j=0; j<N; j++) fprintf(stdout,"%d\n", A[i][j]);
+        for(j=0; j<N; j++) fprintf(stdout,"%d\n", MAT(A,i,j));
      */
 
-     return 0;
-}
+#ifdef VERIFY
+     /* every path has to add up to its distance over the original edges */
+     if(next) {
+        int *path=malloc(N*sizeof(int));
+        int n, d, p;
 
-inline int min(int a, int b)
-{
-     if(a<=b)return a;
-     else return b;
-}
+        for(i=0; i<N; i++)
+           for(j=0; j<N; j++) {
+              n=paths_query(A,next,i,j,path);
+              for(d=0, p=1; p<n; p++)
+                 d+=MAT(R,path[p-1],path[p]);
+              if(path[n-1]!=j || d!=BMAT(A,i,j)){
+                 fprintf(stderr,"VERIFY: path %d -> %d is %d long, expected %d\n",i,j,d,BMAT(A,i,j));
+                 exit(1);
+              }
+           }
+        free(path);
+     }
+     fw_classic(R);
+     if(!sparse)
+        matrix_unblock(A);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++)
+           if(MAT(A,i,j)!=MAT(R,i,j)){
+              fprintf(stderr,"VERIFY: A[%d][%d]=%d, expected %d\n",i,j,MAT(A,i,j),MAT(R,i,j));
+              exit(1);
+           }
+     fprintf(stderr,"VERIFY: ok\n");
+     matrix_free(R);
+#endif
 
-inline void FW(int **A, int K, int I, int J, int N)
-{
-     int i,j,k;
+     free(next);
+     matrix_free(A);
 
-     for(k=K; k<K+N; k++)
-        for(i=I; i<I+N; i++)
-           for(j=J; j<J+N; j++)
-              A[i][j]=min(A[i][j], A[i][k]+A[k][j]);
+     return 0;
+}
 
+/* tiles are stored contiguously, N x N each with leading dimension N */
+static inline void FW(matrix *A, int K, int I, int J, int N)
+{
+     if(A16) {
+        if(I==K && J==K)
+           minplus16_diag(TILE16(A,K,K), N);
+        else if(I==K)
+           minplus16_row(TILE16(A,K,J), TILE16(A,K,K), N);
+        else if(J==K)
+           minplus16_col(TILE16(A,I,K), TILE16(A,K,K), N);
+        else
+           minplus16_inner(TILE16(A,I,J), TILE16(A,I,K), TILE16(A,K,J), N);
+     }
+     else if(next) {
+        if(I==K && J==K)
+           minplus_diag_path(TILE(A,K,K), next+(TILE(A,K,K)-A->data), N);
+        else if(I==K)
+           minplus_row_path(TILE(A,K,J), next+(TILE(A,K,J)-A->data), TILE(A,K,K),
+                            next+(TILE(A,K,K)-A->data), N);
+        else if(J==K)
+           minplus_col_path(TILE(A,I,K), next+(TILE(A,I,K)-A->data), TILE(A,K,K), N);
+        else
+           minplus_inner_path(TILE(A,I,J), next+(TILE(A,I,J)-A->data), TILE(A,I,K),
+                              next+(TILE(A,I,K)-A->data), TILE(A,K,J), N);
+     }
+     else if(I==K && J==K)
+        minplus_diag(TILE(A,K,K), N);
+     else if(I==K)
+        minplus_row(TILE(A,K,J), TILE(A,K,K), N);
+     else if(J==K)
+        minplus_col(TILE(A,I,K), TILE(A,K,K), N);
+     else
+        minplus_inner(TILE(A,I,J), TILE(A,I,K), TILE(A,K,J), N);
 }
@@ -0,0 +1,200 @@
+/*
+  Tiled Floyd-Warshall scheduled by tile dependences.
+  command-line arguments: N, B
+  N = size of graph
+  B = size of tile
+  works only when N is a multiple of B
+  compile: gcc -O3 -fopenmp fw_tiled_dep.c util.c ../../common/matrix.c ../../common/minplus.c
+  add -DVERIFY to check the result against the classic algorithm
+
+  One thread creates the tasks of all rounds up front. Every tile update
+  declares the tiles it reads and the tile it writes as depend clauses, so
+  a task of round k+1 starts as soon as the tiles it needs are final,
+  without a barrier between rounds. Tasks on the next pivot row and
+  column get a higher priority so the next diagonal tile is ready early
+  (needs OMP_MAX_TASK_PRIORITY=1).
+
+  Busy and idle time of every thread is printed to stderr. With
+  FW_TRACE=file every task is also written there as
+  "thread round I J start end", in seconds from the start of the run.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <omp.h>
+#include "util.h"
+#include "../../common/matrix.h"
+#include "../../common/minplus.h"
+
+typedef struct {
+     int k, I, J;
+     double start, end;
+} trace_entry;
+
+/* per thread, padded to a cache line */
+typedef struct {
+     double busy;
+     long tasks, size;
+     trace_entry *trace;
+     char pad[32];
+} thread_stats;
+
+static thread_stats *stats;
+static double t0;
+static int tracing;
+
+inline void FW(matrix *A, int K, int I, int J, int N);
+
+static void run_tile(matrix *A, int K, int I, int J, int B)
+{
+     thread_stats *s=&stats[omp_get_thread_num()];
+     double start=omp_get_wtime(), end;
+
+     FW(A,K,I,J,B);
+     end=omp_get_wtime();
+     s->busy+=end-start;
+     if(tracing) {
+        if(s->tasks==s->size) {
+           s->size=s->size ? 2*s->size : 4096;
+           s->trace=realloc(s->trace, s->size*sizeof(trace_entry));
+        }
+        s->trace[s->tasks].k=K;
+        s->trace[s->tasks].I=I;
+        s->trace[s->tasks].J=J;
+        s->trace[s->tasks].start=start-t0;
+        s->trace[s->tasks].end=end-t0;
+     }
+     s->tasks++;
+}
+
+int main(int argc, char **argv)
+{
+     matrix *A;
+#ifdef VERIFY
+     matrix *R;
+#endif
+     int i,j,k,t,nthreads;
+     struct timeval t1, t2;
+     double time;
+     int B=64;
+     int N=1024;
+     char *trace_file=getenv("FW_TRACE");
+
+     if (argc != 3){
+        fprintf(stdout, "Usage %s N B\n", argv[0]);
+        exit(0);
+     }
+
+     N=atoi(argv[1]);
+     B=atoi(argv[2]);
+
+     A=matrix_alloc(N);
+
+     graph_init_random(A->rows,-1,N,128*N);
+#ifdef VERIFY
+     R=matrix_alloc(N);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++) MAT(R,i,j)=MAT(A,i,j);
+#endif
+     matrix_block(A,B);
+     minplus_init();
+
+     nthreads=omp_get_max_threads();
+     stats=calloc(nthreads, sizeof(thread_stats));
+     tracing=trace_file!=NULL;
+
+     gettimeofday(&t1,0);
+     t0=omp_get_wtime();
+
+     #pragma omp parallel
+     #pragma omp single
+     for(k=0;k<N;k+=B){
+        int next=k+B;
+
+        #pragma omp task firstprivate(k) depend(inout: TILE(A,k,k)[0]) priority(1)
+        run_tile(A,k,k,k,B);
+
+        for(i=0; i<N; i+=B) {
+           if(i==k) continue;
+           #pragma omp task firstprivate(k,i) depend(in: TILE(A,k,k)[0]) \
+                            depend(inout: TILE(A,i,k)[0]) priority(i==next)
+           run_tile(A,k,i,k,B);
+           #pragma omp task firstprivate(k,i) depend(in: TILE(A,k,k)[0]) \
+                            depend(inout: TILE(A,k,i)[0]) priority(i==next)
+           run_tile(A,k,k,i,B);
+        }
+
+        for(i=0; i<N; i+=B) {
+           if(i==k) continue;
+           for(j=0; j<N; j+=B) {
+              if(j==k) continue;
+              #pragma omp task firstprivate(k,i,j) depend(in: TILE(A,i,k)[0], TILE(A,k,j)[0]) \
+                               depend(inout: TILE(A,i,j)[0]) priority(i==next || j==next)
+              run_tile(A,k,i,j,B);
+           }
+        }
+     }
+     gettimeofday(&t2,0);
+
+     time=(double)((t2.tv_sec-t1.tv_sec)*1000000+t2.tv_usec-t1.tv_usec)/1000000;
+     printf("FW_TILED_DEP,%d,%d,%.4f,%d\n", N,B,time, nthreads);
+
+     for(t=0; t<nthreads; t++)
+        fprintf(stderr, "thread %d: tasks %ld busy %.4f idle %.4f\n",
+                t, stats[t].tasks, stats[t].busy, time-stats[t].busy);
+
+     if(tracing) {
+        FILE *f=fopen(trace_file, "w");
+        long n;
+
+        if(f==NULL) {
+           perror(trace_file);
+           exit(1);
+        }
+        for(t=0; t<nthreads; t++)
+           for(n=0; n<stats[t].tasks; n++)
+              fprintf(f, "%d %d %d %d %.6f %.6f\n", t, stats[t].trace[n].k/B,
+                      stats[t].trace[n].I/B, stats[t].trace[n].J/B,
+                      stats[t].trace[n].start, stats[t].trace[n].end);
+        fclose(f);
+     }
+
+     /*
+     matrix_unblock(A);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++) fprintf(stdout,"%d\n", MAT(A,i,j));
+     */
+
+#ifdef VERIFY
+     fw_classic(R);
+     matrix_unblock(A);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++)
+           if(MAT(A,i,j)!=MAT(R,i,j)){
+              fprintf(stderr,"VERIFY: A[%d][%d]=%d, expected %d\n",i,j,MAT(A,i,j),MAT(R,i,j));
+              exit(1);
+           }
+     fprintf(stderr,"VERIFY: ok\n");
+     matrix_free(R);
+#endif
+
+     for(t=0; t<nthreads; t++)
+        free(stats[t].trace);
+     free(stats);
+     matrix_free(A);
+
+     return 0;
+}
+
+/* tiles are stored contiguously, N x N each with leading dimension N */
+inline void FW(matrix *A, int K, int I, int J, int N)
+{
+     if(I==K && J==K)
+        minplus_diag(TILE(A,K,K), N);
+     else if(I==K)
+        minplus_row(TILE(A,K,J), TILE(A,K,K), N);
+     else if(J==K)
+        minplus_col(TILE(A,I,K), TILE(A,K,K), N);
+     else
+        minplus_inner(TILE(A,I,J), TILE(A,I,K), TILE(A,K,J), N);
+}
@@ -1,51 +1,112 @@
 /*
  Standard implementation of the Floyd-Warshall Algorithm
+ command-line arguments: N, [U]
+ N = size of graph
+ U = afterwards shorten U random edges with fw_decrease (incremental.h)
+     and time that separately
+ compile: gcc -O3 -fopenmp fw.c util.c ../../common/matrix.c ../../common/incremental.c ../../common/minplus.c
+ add -DVERIFY to check the updated distances against a full recomputation
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include "util.h"
+#include "../../common/matrix.h"
+#include "../../common/incremental.h"
+#include "../../common/minplus.h"
 
 inline int min(int a, int b);
 
 int main(int argc, char **argv)
 {
-     int **A;
+     matrix *A;
      int i,j,k;
      struct timeval t1, t2;
      double time;
      int N=1024;
+     int U=0;
+     edge_update *updates;
+     long changed;
+#ifdef VERIFY
+     matrix *R;
+#endif
 
-     if (argc != 2) {
-        fprintf(stdout,"Usage: %s N\n", argv[0]);
+     if (argc != 2 && argc != 3) {
+        fprintf(stdout,"Usage: %s N [U]\n", argv[0]);
         exit(0);
      }
 
      N=atoi(argv[1]);
+     if (argc == 3)
+        U=atoi(argv[2]);
 
-     A = (int **) malloc(N*sizeof(int *));
-     for(i=0; i<N; i++) A[i] = (int *) malloc(N*sizeof(int));
+     A = matrix_alloc(N);
 
-     graph_init_random(A,-1,N,128*N);
+     graph_init_random(A->rows,-1,N,128*N);
+#ifdef VERIFY
+     R = matrix_alloc(N);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++) MAT(R,i,j)=MAT(A,i,j);
+#endif
 
      gettimeofday(&t1,0);
      for(k=0;k<N;k++)
         #pragma omp parallel for private(j)
-        for(i=0; i<N; i++)
+        for(i=0; i<N; i++) {
+           /* A[k][k] >= 0, so A[i][k] does not change during step k */
+           int *Ai = &MAT(A,i,0), *Ak = &MAT(A,k,0);
+           int Aik = Ai[k];
            for(j=0; j<N; j++)
-              A[i][j]=min(A[i][j], A[i][k] + A[k][j]);
+              Ai[j]=min(Ai[j], Aik + Ak[j]);
+        }
 
      gettimeofday(&t2,0);
 
      time=(double)((t2.tv_sec-t1.tv_sec)*1000000+t2.tv_usec-t1.tv_usec)/1000000;
      printf("FW,%d,%.4f,%d\n", N, time, atoi(getenv("OMP_NUM_THREADS")));
 
+     if (U > 0) {
+        /* new edges, each shorter than the path it replaces */
+        updates = malloc(U*sizeof(edge_update));
+        for(k=0; k<U; k++) {
+           updates[k].u = rand()%N;
+           updates[k].v = rand()%N;
+           updates[k].w = MAT(A,updates[k].u,updates[k].v)/2;
+        }
+
+        gettimeofday(&t1,0);
+        changed = fw_decrease(A, updates, U);
+        gettimeofday(&t2,0);
+
+        time=(double)((t2.tv_sec-t1.tv_sec)*1000000+t2.tv_usec-t1.tv_usec)/1000000;
+        printf("FW_UPDATE,%d,%d,%.4f,%d,%ld\n", N, U, time, atoi(getenv("OMP_NUM_THREADS")), changed);
+
+#ifdef VERIFY
+        for(k=0; k<U; k++)
+           MAT(R,updates[k].u,updates[k].v) = min(MAT(R,updates[k].u,updates[k].v), updates[k].w);
+        fw_classic(R);
+        for(i=0; i<N; i++)
+           for(j=0; j<N; j++)
+              if(MAT(A,i,j)!=MAT(R,i,j)){
+                 fprintf(stderr,"VERIFY: A[%d][%d]=%d, expected %d\n",i,j,MAT(A,i,j),MAT(R,i,j));
+                 exit(1);
+              }
+        fprintf(stderr,"VERIFY: ok\n");
+#endif
+        free(updates);
+     }
+#ifdef VERIFY
+     matrix_free(R);
+#endif
+
      /*
      for(i=0; i<N; i++)
-        for(j=0; j<N; j++) fprintf(stdout,"%d\n", A[i][j]);
+        for(j=0; j<N; j++) fprintf(stdout,"%d\n", MAT(A,i,j));
      */
 
+     matrix_free(A);
+
      return 0;     
 }
 
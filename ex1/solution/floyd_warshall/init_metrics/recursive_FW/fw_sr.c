@@ -2,24 +2,83 @@
   Recursive implementation of the Floyd-Warshall algorithm.
   command line arguments: N, B
   N = size of graph
-  B = size of submatrix when recursion stops
+  B = size of submatrix when recursion stops, or auto to pick it and
+      the thread count (tune.h)
   works only for N, B = 2^k
+  compile: gcc -O3 -fopenmp fw_sr.c util.c ../../common/matrix.c ../../common/minplus.c ../../common/tune.c
+  add -DVERIFY to check the result against the classic algorithm
+
+  The matrix is stored in Z-order (matrix_zorder), so each quadrant the
+  recursion visits is one contiguous block and the B x B leaves are the
+  tiles the min-plus kernels work on. There is a single parallel region;
+  the recursion creates tasks only in its top levels, down to where
+  there are a few tasks per thread or the three quadrants of a call fit
+  the L2 cache, and runs serially below that.
 */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <omp.h>
 #include "util.h"
+#include "../../common/matrix.h"
+#include "../../common/minplus.h"
+#include "../../common/tune.h"
+
+void FW_SR (int *A, int *B, int *C, int myN, int depth);
+
+static int bsize;       /* leaf size */
+static int cutoff;      /* deepest level that still creates tasks */
+
+/* levels worth splitting into tasks for N */
+static int task_cutoff(int N, int threads)
+{
+     long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+     int depth = 0, spread = 0;
+
+     if (threads <= 1)
+        return -1;
+     if (l2 <= 0)
+        l2 = 1 << 20;
+     /* at depth d about 2^d calls can run at once, aim for 4 per thread */
+     while ((1 << spread) < 4*threads)
+        spread++;
+     /* stop where A, B and C of one call fit the L2 */
+     while (depth < spread && 3L*(N>>depth)*(N>>depth)*sizeof(int) > (unsigned long)l2)
+        depth++;
+     return depth;
+}
+
+/* the whole recursion on the top left corner of A, up to 1024, seconds per N^3 */
+static double trial(int B, void *arg)
+{
+     matrix *A=arg;
+     int M=A->N<1024 ? A->N : 1024, i;
+     matrix *T=matrix_alloc(M);
+     double t;
 
-inline int min(int a, int b);
-void FW_SR (int **A, int arow, int acol, 
-            int **B, int brow, int bcol, 
-            int **C, int crow, int ccol, 
-            int myN, int bsize);
+     for(i=0; i<M; i++)
+        memcpy(&MAT(T,i,0), &MAT(A,i,0), M*sizeof(int));
+     matrix_zorder(T,B);
+     bsize=B;
+     cutoff=task_cutoff(M, omp_get_max_threads());
+     t=omp_get_wtime();
+     #pragma omp parallel
+     #pragma omp single
+     FW_SR(T->data,T->data,T->data,M,0);
+     t=omp_get_wtime()-t;
+     matrix_free(T);
+     return t/((double)M*M*M);
+}
 
 int main(int argc, char **argv)
 {
-     int **A;
+     matrix *A;
+#ifdef VERIFY
+     matrix *R;
+#endif
      int i,j;
      struct timeval t1, t2;
      double time;
@@ -34,66 +93,100 @@ int main(int argc, char **argv)
      N=atoi(argv[1]);
      B=atoi(argv[2]);
 
-     A = (int **) malloc(N*sizeof(int *));
-     for(i=0; i<N; i++) A[i] = (int *) malloc(N*sizeof(int));
+     A = matrix_alloc(N);
 
-     graph_init_random(A,-1,N,128*N);
+     graph_init_random(A->rows,-1,N,128*N);
+#ifdef VERIFY
+     R=matrix_alloc(N);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++) MAT(R,i,j)=MAT(A,i,j);
+#endif
+     minplus_init();
+     if (strcmp(argv[2], "auto") == 0)
+        B = tune_tile("fw_sr", N, trial, A);
+     matrix_zorder(A,B);
+     bsize = B;
+     cutoff = task_cutoff(N, omp_get_max_threads());
 
      gettimeofday(&t1,0);
-     FW_SR(A,0,0, A,0,0,A,0,0,N,B);
+     #pragma omp parallel
+     #pragma omp single
+     FW_SR(A->data,A->data,A->data,N,0);
      gettimeofday(&t2,0);
 
      time=(double)((t2.tv_sec-t1.tv_sec)*1000000+t2.tv_usec-t1.tv_usec)/1000000;
-     printf("FW_SR,%d,%d,%.4f,%d\n", N, B, time, atoi(getenv("OMP_NUM_THREADS")));
+     printf("FW_SR,%d,%d,%.4f,%d\n", N, B, time, omp_get_max_threads());
 
      /*
+     matrix_unblock(A);
      for(i=0; i<N; i++)
-        for(j=0; j<N; j++) fprintf(stdout,"%d\n", A[i][j]);
+        for(j=0; j<N; j++) fprintf(stdout,"%d\n", MAT(A,i,j));
      */
 
+#ifdef VERIFY
+     fw_classic(R);
+     matrix_unblock(A);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++)
+           if(MAT(A,i,j)!=MAT(R,i,j)){
+              fprintf(stderr,"VERIFY: A[%d][%d]=%d, expected %d\n",i,j,MAT(A,i,j),MAT(R,i,j));
+              exit(1);
+           }
+     fprintf(stderr,"VERIFY: ok\n");
+     matrix_free(R);
+#endif
+
+     matrix_free(A);
+
      return 0;
 }
 
-inline int min(int a, int b)
+/*
+  A = min(A, B + C) on myN x myN blocks in Z-order; quadrant q of a
+  block starts q*(myN/2)^2 ints in, top left, top right, bottom left,
+  bottom right.
+*/
+void FW_SR (int *A, int *B, int *C, int myN, int depth)
 {
-     if(a<=b)return a;
-     else return b;
-}
+     size_t q = (size_t)myN/2*(myN/2);
+     int h = myN/2;
 
-void FW_SR (int **A, int arow, int acol, 
-            int **B, int brow, int bcol, 
-            int **C, int crow, int ccol, 
-            int myN, int bsize)
-{
-     int k,i,j;
-     
-     if(myN<=bsize)
-        for(k=0; k<myN; k++)
-           for(i=0; i<myN; i++)
-              for(j=0; j<myN; j++)
-                 A[arow+i][acol+j]=min(A[arow+i][acol+j], B[brow+i][bcol+k]+C[crow+k][ccol+j]);
+     if(myN<=bsize) {
+        if(A==B && A==C)
+           minplus_diag(A, myN);
+        else if(A==C)
+           minplus_row(A, B, myN);
+        else if(A==B)
+           minplus_col(A, C, myN);
+        else
+           minplus_inner(A, B, C, myN);
+     }
+     else if(depth<=cutoff) {
+        FW_SR(A,B,C,h,depth+1);
+        #pragma omp task
+            FW_SR(A+q,B,C+q,h,depth+1);
+        #pragma omp task
+            FW_SR(A+2*q,B+2*q,C,h,depth+1);
+        #pragma omp taskwait
+        FW_SR(A+3*q,B+2*q,C+q,h,depth+1);
+
+        FW_SR(A+3*q,B+3*q,C+3*q,h,depth+1);
+        #pragma omp task
+            FW_SR(A+2*q,B+3*q,C+2*q,h,depth+1);
+        #pragma omp task
+            FW_SR(A+q,B+q,C+3*q,h,depth+1);
+        #pragma omp taskwait
+        FW_SR(A,B+q,C+2*q,h,depth+1);
+     }
      else {
-        #pragma omp parallel
-        {
-            #pragma omp single
-            {
-                FW_SR(A,arow, acol,B,brow, bcol,C,crow, ccol, myN/2, bsize);
-                #pragma omp task
-                    FW_SR(A,arow, acol+myN/2,B,brow, bcol,C,crow, ccol+myN/2, myN/2, bsize);
-                #pragma omp task
-                    FW_SR(A,arow+myN/2, acol,B,brow+myN/2, bcol,C,crow, ccol, myN/2, bsize);
-                #pragma omp taskwait
-                FW_SR(A,arow+myN/2, acol+myN/2,B,brow+myN/2, bcol,C,crow, ccol+myN/2, myN/2, bsize);
-
-                FW_SR(A,arow+myN/2, acol+myN/2,B,brow+myN/2, bcol+myN/2,C,crow+myN/2, ccol+myN/2, myN/2, bsize);
-                #pragma omp task
-                    FW_SR(A,arow+myN/2, acol,B,brow+myN/2, bcol+myN/2,C,crow+myN/2, ccol, myN/2, bsize);
-                #pragma omp task
-                    FW_SR(A,arow, acol+myN/2,B,brow, bcol+myN/2,C,crow+myN/2, ccol+myN/2, myN/2, bsize);
-                #pragma omp taskwait
-                FW_SR(A,arow, acol,B,brow, bcol+myN/2,C,crow+myN/2, ccol, myN/2, bsize);
-            }
-         }
+        FW_SR(A,B,C,h,depth+1);
+        FW_SR(A+q,B,C+q,h,depth+1);
+        FW_SR(A+2*q,B+2*q,C,h,depth+1);
+        FW_SR(A+3*q,B+2*q,C+q,h,depth+1);
+
+        FW_SR(A+3*q,B+3*q,C+3*q,h,depth+1);
+        FW_SR(A+2*q,B+3*q,C+2*q,h,depth+1);
+        FW_SR(A+q,B+q,C+3*q,h,depth+1);
+        FW_SR(A,B+q,C+2*q,h,depth+1);
      }
 }
-
@@ -4,18 +4,24 @@
   N = size of graph
   B = size of tile
   works only when N is a multiple of B
+  compile: gcc -O3 -fopenmp fw_tiled.c util.c ../../common/matrix.c ../../common/minplus.c
+  add -DVERIFY to check the result against the classic algorithm
 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include "util.h"
+#include "../../common/matrix.h"
+#include "../../common/minplus.h"
 
-inline int min(int a, int b);
-inline void FW(int **A, int K, int I, int J, int N);
+inline void FW(matrix *A, int K, int I, int J, int N);
 
 int main(int argc, char **argv)
 {
-     int **A;
+     matrix *A;
+#ifdef VERIFY
+     matrix *R;
+#endif
      int i,j,k;
      struct timeval t1, t2;
      double time;
@@ -30,10 +36,16 @@ int main(int argc, char **argv)
      N=atoi(argv[1]);
      B=atoi(argv[2]);
 
-     A=(int **)malloc(N*sizeof(int *));
-     for(i=0; i<N; i++)A[i]=(int *)malloc(N*sizeof(int));
+     A=matrix_alloc(N);
 
-     graph_init_random(A,-1,N,128*N);
+     graph_init_random(A->rows,-1,N,128*N);
+#ifdef VERIFY
+     R=matrix_alloc(N);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++) MAT(R,i,j)=MAT(A,i,j);
+#endif
+     matrix_block(A,B);
+     minplus_init();
 
      gettimeofday(&t1,0);
 
@@ -92,26 +104,38 @@ int main(int argc, char **argv)
      printf("FW_TILED,%d,%d,%.4f,%d\n", N,B,time, atoi(getenv("OMP_NUM_THREADS")));
 
      /*
+     matrix_unblock(A);
      for(i=0; i<N; i++)
-        for(j=0; j<N; j++) fprintf(stdout,"%d\n", A[i][j]);
+        for(j=0; j<N; j++) fprintf(stdout,"%d\n", MAT(A,i,j));
      */
 
-     return 0;
-}
+#ifdef VERIFY
+     fw_classic(R);
+     matrix_unblock(A);
+     for(i=0; i<N; i++)
+        for(j=0; j<N; j++)
+           if(MAT(A,i,j)!=MAT(R,i,j)){
+              fprintf(stderr,"VERIFY: A[%d][%d]=%d, expected %d\n",i,j,MAT(A,i,j),MAT(R,i,j));
+              exit(1);
+           }
+     fprintf(stderr,"VERIFY: ok\n");
+     matrix_free(R);
+#endif
 
-inline int min(int a, int b)
-{
-     if(a<=b)return a;
-     else return b;
+     matrix_free(A);
+
+     return 0;
 }
 
-inline void FW(int **A, int K, int I, int J, int N)
+/* tiles are stored contiguously, N x N each with leading dimension N */
+inline void FW(matrix *A, int K, int I, int J, int N)
 {
-     int i,j,k;
-     
-     for(k=K; k<K+N; k++)
-        for(i=I; i<I+N; i++)
-           for(j=J; j<J+N; j++)
-              A[i][j]=min(A[i][j], A[i][k]+A[k][j]);
-     
+     if(I==K && J==K)
+        minplus_diag(TILE(A,K,K), N);
+     else if(I==K)
+        minplus_row(TILE(A,K,J), TILE(A,K,K), N);
+     else if(J==K)
+        minplus_col(TILE(A,I,K), TILE(A,K,K), N);
+     else
+        minplus_inner(TILE(A,I,J), TILE(A,I,K), TILE(A,K,J), N);
 }
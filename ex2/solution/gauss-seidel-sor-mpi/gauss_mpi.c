@@ -4,8 +4,10 @@
 #include <sys/types.h>
 #include <math.h>
 #include <sys/time.h>
+#include <omp.h>
 #include "mpi.h"
 #include "utils.h"
+#include "halo.h"
 
 
 int converge(double ** u_previous, double ** u_current, int Xm, int Ym, int X, int Y) {
@@ -20,15 +22,30 @@ int converge(double ** u_previous, double ** u_current, int Xm, int Ym, int X, i
     return 1;
 }
 
+#define GS_TILE 64
+
+/*Point (i,j) needs the new values of (i-1,j) and (i,j-1), so the subdomain is
+  cut into GS_TILE x GS_TILE tiles and swept in anti-diagonals of tiles
+  (wavefront): the tiles of one diagonal only depend on the diagonal before
+  and are updated in parallel. Every point sees the same values as in the
+  serial row by row sweep.*/
 void GaussSeidel(double ** u_previous, double ** u_current, int X_min, int X_max, int Y_min, int Y_max, double omega) {
-    int i,j;
-    for (i=X_min;i<X_max;i++)
-        for (j=Y_min;j<Y_max;j++)
-            u_current[i][j]=u_previous[i][j]+(u_current[i-1][j]+u_previous[i+1][j]+u_current[i][j-1]+u_previous[i][j+1]-4*u_previous[i][j])*omega/4.0;
+    int i,j,I,J,d;
+    int tiles_x=(X_max-X_min+GS_TILE-1)/GS_TILE, tiles_y=(Y_max-Y_min+GS_TILE-1)/GS_TILE;
+    #pragma omp parallel private(i,j,I,J,d)
+    for (d=0;d<tiles_x+tiles_y-1;d++) {
+        #pragma omp for schedule(static)
+        for (I=(d<tiles_y ? 0 : d-tiles_y+1);I<=(d<tiles_x ? d : tiles_x-1);I++) {
+            J=d-I;
+            for (i=X_min+I*GS_TILE;i<X_min+(I+1)*GS_TILE && i<X_max;i++)
+                for (j=Y_min+J*GS_TILE;j<Y_min+(J+1)*GS_TILE && j<Y_max;j++)
+                    u_current[i][j]=u_previous[i][j]+(u_current[i-1][j]+u_previous[i+1][j]+u_current[i][j-1]+u_previous[i][j+1]-4*u_previous[i][j])*omega/4.0;
+        }
+    }
 }
 
 int main(int argc, char ** argv) {
-    int rank,size;
+    int rank,size,provided;
     int global[2],local[2]; //global matrix dimensions and local matrix dimensions (2D-domain, 2D-subdomain)
     int global_padded[2];   //padded global matrix dimensions (if padding is not needed, global_padded=global)
     int grid[2];            //processor grid dimensions
@@ -43,9 +60,15 @@ int main(int argc, char ** argv) {
 
     double ** U, ** u_current, ** u_previous, ** swap; //Global matrix, local current and previous matrices, pointer to swap between current and previous
 
-    MPI_Init(&argc,&argv);
+    //only the master thread calls MPI, between the parallel kernels
+    MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
     MPI_Comm_size(MPI_COMM_WORLD,&size);
     MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+    if (provided<MPI_THREAD_FUNNELED) {
+        if (rank==0)
+            fprintf(stderr,"MPI does not support MPI_THREAD_FUNNELED\n");
+        MPI_Abort(MPI_COMM_WORLD,-1);
+    }
 
     //----Read 2D-domain dimensions and process grid dimensions from stdin----//
 
@@ -160,15 +183,6 @@ int main(int argc, char ** argv) {
         free2d(U);
     }
 
-    //----Define datatypes or allocate buffers for message passing----//
-    MPI_Datatype column, row;
-
-    MPI_Type_vector(local[0] + 1, 1, local[1] + 2, MPI_DOUBLE, &column);
-    MPI_Type_commit(&column);
-
-    MPI_Type_contiguous(local[1] + 2, MPI_DOUBLE, &row);
-    MPI_Type_commit(&row);
-
     //----Find the 4 neighbors with which a process exchanges messages----//
 
     /*Make sure you handle non-existing
@@ -177,6 +191,11 @@ int main(int argc, char ** argv) {
     MPI_Cart_shift(CART_COMM, 0, 1, &north, &south);
     MPI_Cart_shift(CART_COMM, 1, 1, &west, &east);
 
+    //----Set up the halo exchange of both arrays once----//
+    halo * h_current, * h_previous, * hswap;
+    h_current = halo_create(u_current, local, north, south, west, east, CART_COMM);
+    h_previous = halo_create(u_previous, local, north, south, west, east, CART_COMM);
+
     //---Define the iteration ranges per process-----//
     int i_min,i_max,j_min,j_max;
     if(north > -1)
@@ -205,8 +224,6 @@ int main(int argc, char ** argv) {
         -boundary processes and padded global array
     */
 
-    MPI_Request requests[8];
-    int requests_cnt = 0;
     //----Computational core----//   
     gettimeofday(&tts, NULL);
     #ifdef TEST_CONV
@@ -223,17 +240,13 @@ int main(int argc, char ** argv) {
         swap = u_previous;
         u_previous = u_current;
         u_current = swap;
+        hswap = h_previous;
+        h_previous = h_current;
+        h_current = hswap;
 
-        requests_cnt = 0;
-        if(north > -1) {
-            MPI_Irecv(&(u_current[0][0]), 1, row, north, north * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-        }
-
-        if(west > -1) {
-            MPI_Irecv(&(u_current[0][0]), 1, column, west, west * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-        }
-
-        MPI_Waitall(requests_cnt, requests, MPI_STATUSES_IGNORE);
+        //the new values north and west of the subdomain
+        halo_start(h_current, 0, HALO_NORTH | HALO_WEST);
+        halo_wait(h_current);
 
         gettimeofday(&tcs, NULL);
 
@@ -243,22 +256,9 @@ int main(int argc, char ** argv) {
         tcomp += (tcf.tv_sec - tcs.tv_sec)
             + (tcf.tv_usec - tcs.tv_usec) * 0.000001;
 
-        requests_cnt = 0;
-        if(north > -1) {
-            MPI_Isend(&(u_current[1][0]), 1, row, north, rank * 10 + north, CART_COMM, &requests[requests_cnt++]);
-        }
-        if(south > -1) {
-            MPI_Irecv(&(u_current[local[0] + 1][0]), 1, row, south, south * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-            MPI_Isend(&(u_current[local[0]][0]), 1, row, south, rank * 10 + south, CART_COMM, &requests[requests_cnt++]);
-        }
-        if(west > -1) {
-            MPI_Isend(&(u_current[0][1]), 1, column, west, rank * 10 + west, CART_COMM, &requests[requests_cnt++]);
-        }
-        if(east > -1) {
-            MPI_Irecv(&(u_current[0][local[1] + 1]), 1, column, east, east * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-            MPI_Isend(&(u_current[0][local[1]]), 1, column, east, rank * 10 + east, CART_COMM, &requests[requests_cnt++]);
-        }
-        MPI_Waitall(requests_cnt, requests, MPI_STATUSES_IGNORE);
+        //send all sides, the south and east ghosts are read as u_previous next iteration
+        halo_start(h_current, HALO_ALL, HALO_SOUTH | HALO_EAST);
+        halo_wait(h_current);
 
 
         gettimeofday(&tconvs, NULL);
@@ -278,6 +278,8 @@ int main(int argc, char ** argv) {
     }
     gettimeofday(&ttf,NULL);
     ttotal=(ttf.tv_sec-tts.tv_sec)+(ttf.tv_usec-tts.tv_usec)*0.000001;
+    halo_free(h_current);
+    halo_free(h_previous);
     MPI_Reduce(&ttotal,&total_time,1,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
     MPI_Reduce(&tcomp,&comp_time,1,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
     MPI_Reduce(&tconv, &conv_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
@@ -316,7 +318,7 @@ int main(int argc, char ** argv) {
     //----Printing results----//
 
     if (rank==0) {
-        printf("GaussSeidelSOR X %d Y %d Px %d Py %d Iter %d ComputationTime %lf Convergence Time %lf TotalTime %lf midpoint %lf processes %d\n",global[0],global[1],grid[0],grid[1],t,comp_time,conv_time,total_time,U[global[0]/2][global[1]/2], size);
+        printf("GaussSeidelSOR X %d Y %d Px %d Py %d Iter %d ComputationTime %lf Convergence Time %lf TotalTime %lf midpoint %lf processes %d threads %d\n",global[0],global[1],grid[0],grid[1],t,comp_time,conv_time,total_time,U[global[0]/2][global[1]/2], size, omp_get_max_threads());
 
         #ifdef PRINT_RESULTS
         char * s=malloc(50*sizeof(char));
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "halo.h"
+
+//side s of the subdomain is bit 1<<s of a side mask, the opposite side is s^1
+#define NORTH 0
+#define SOUTH 1
+#define WEST 2
+#define EAST 3
+
+static int halo_backend ( void ) {
+    char * backend = getenv( "HALO_EXCHANGE" );
+    if ( backend == NULL || strcmp( backend, "p2p" ) == 0 )
+        return HALO_P2P;
+    if ( strcmp( backend, "neighbor" ) == 0 )
+        return HALO_NEIGHBOR;
+    fprintf( stderr,"HALO_EXCHANGE must be p2p or neighbor\n" );
+    exit( -1 );
+}
+
+halo * halo_create ( double ** u, int local[2], int north, int south, int west, int east, MPI_Comm comm ) {
+    halo * h;
+    double * out[4], * in[4];
+    int count[4];
+    int s;
+
+    h = ( halo * )malloc( sizeof( halo ) );
+    if ( h == NULL ) {
+        fprintf( stderr,"Error in allocation\n" );
+        exit( -1 );
+    }
+    h->u = u;
+    h->rows = local[0];
+    h->cols = local[1];
+    h->neighbors[NORTH] = north;
+    h->neighbors[SOUTH] = south;
+    h->neighbors[WEST] = west;
+    h->neighbors[EAST] = east;
+    h->sending = h->receiving = 0;
+    h->backend = halo_backend();
+    h->comm = comm;
+    h->collective = MPI_REQUEST_NULL;
+    h->collective_started = 0;
+    for ( s = 0 ; s < 2 ; s++ ) {
+        h->column_out[s] = ( double * )malloc( local[0] * sizeof( double ) );
+        h->column_in[s] = ( double * )malloc( local[0] * sizeof( double ) );
+        if ( h->column_out[s] == NULL || h->column_in[s] == NULL ) {
+            fprintf( stderr,"Error in allocation\n" );
+            exit( -1 );
+        }
+    }
+
+    //rows without the corners, which the 5-point stencils never read
+    out[NORTH] = &(u[1][1]);
+    in[NORTH] = &(u[0][1]);
+    out[SOUTH] = &(u[local[0]][1]);
+    in[SOUTH] = &(u[local[0] + 1][1]);
+    count[NORTH] = count[SOUTH] = local[1];
+    out[WEST] = h->column_out[0];
+    in[WEST] = h->column_in[0];
+    out[EAST] = h->column_out[1];
+    in[EAST] = h->column_in[1];
+    count[WEST] = count[EAST] = local[0];
+
+    for ( s = 0 ; s < 4 ; s++ ) {
+        h->send[s] = h->recv[s] = MPI_REQUEST_NULL;
+        if ( h->neighbors[s] < 0 )
+            continue;
+        //the message sent towards side s is tagged with s, the one from side s with s^1
+        MPI_Recv_init( in[s], count[s], MPI_DOUBLE, h->neighbors[s], 1 << ( s ^ 1 ), comm, &h->recv[s] );
+        MPI_Send_init( out[s], count[s], MPI_DOUBLE, h->neighbors[s], 1 << s, comm, &h->send[s] );
+    }
+
+    for ( s = 0 ; s < 4 ; s++ ) {
+        h->counts[s] = h->neighbors[s] < 0 ? 0 : count[s];
+        MPI_Get_address( out[s], &h->out[s] );
+        MPI_Get_address( in[s], &h->in[s] );
+        h->types[s] = MPI_DOUBLE;
+    }
+#if MPI_VERSION >= 4
+    if ( h->backend == HALO_NEIGHBOR )
+        MPI_Neighbor_alltoallw_init( MPI_BOTTOM, h->counts, h->out, h->types,
+            MPI_BOTTOM, h->counts, h->in, h->types, comm, MPI_INFO_NULL, &h->collective );
+#endif
+    return h;
+}
+
+void halo_start ( halo * h, int send_sides, int recv_sides ) {
+    MPI_Request requests[8];
+    int requests_cnt = 0;
+    int i, s;
+    int collective = h->backend == HALO_NEIGHBOR && send_sides == HALO_ALL && recv_sides == HALO_ALL;
+
+    h->sending = h->receiving = 0;
+    for ( s = WEST ; s <= EAST ; s++ )
+        if ( h->neighbors[s] >= 0 && ( send_sides & ( 1 << s ) ) ) {
+            double * column = h->column_out[s - WEST];
+            int j = s == WEST ? 1 : h->cols;
+            for ( i = 0 ; i < h->rows ; i++ )
+                column[i] = h->u[i + 1][j];
+        }
+    if ( collective ) {
+#if MPI_VERSION >= 4
+        MPI_Start( &h->collective );
+#else
+        MPI_Ineighbor_alltoallw( MPI_BOTTOM, h->counts, h->out, h->types,
+            MPI_BOTTOM, h->counts, h->in, h->types, h->comm, &h->collective );
+#endif
+        h->collective_started = 1;
+        for ( s = 0 ; s < 4 ; s++ )
+            if ( h->neighbors[s] >= 0 )
+                h->receiving |= 1 << s;
+        return;
+    }
+    //receives first, so each is posted before the matching send can arrive
+    for ( s = 0 ; s < 4 ; s++ )
+        if ( h->neighbors[s] >= 0 && ( recv_sides & ( 1 << s ) ) ) {
+            requests[requests_cnt++] = h->recv[s];
+            h->receiving |= 1 << s;
+        }
+    for ( s = 0 ; s < 4 ; s++ )
+        if ( h->neighbors[s] >= 0 && ( send_sides & ( 1 << s ) ) ) {
+            requests[requests_cnt++] = h->send[s];
+            h->sending |= 1 << s;
+        }
+    MPI_Startall( requests_cnt, requests );
+}
+
+void halo_wait ( halo * h ) {
+    MPI_Request requests[8];
+    int requests_cnt = 0;
+    int i, s;
+
+    if ( h->collective_started ) {
+        MPI_Wait( &h->collective, MPI_STATUS_IGNORE );
+        h->collective_started = 0;
+    }
+    else {
+        for ( s = 0 ; s < 4 ; s++ ) {
+            if ( h->receiving & ( 1 << s ) )
+                requests[requests_cnt++] = h->recv[s];
+            if ( h->sending & ( 1 << s ) )
+                requests[requests_cnt++] = h->send[s];
+        }
+        MPI_Waitall( requests_cnt, requests, MPI_STATUSES_IGNORE );
+    }
+
+    for ( s = WEST ; s <= EAST ; s++ )
+        if ( h->receiving & ( 1 << s ) ) {
+            double * column = h->column_in[s - WEST];
+            int j = s == WEST ? 0 : h->cols + 1;
+            for ( i = 0 ; i < h->rows ; i++ )
+                h->u[i + 1][j] = column[i];
+        }
+    h->sending = h->receiving = 0;
+}
+
+void halo_free ( halo * h ) {
+    int s;
+    for ( s = 0 ; s < 4 ; s++ ) {
+        if ( h->send[s] != MPI_REQUEST_NULL )
+            MPI_Request_free( &h->send[s] );
+        if ( h->recv[s] != MPI_REQUEST_NULL )
+            MPI_Request_free( &h->recv[s] );
+    }
+    if ( h->collective != MPI_REQUEST_NULL )
+        MPI_Request_free( &h->collective );
+    for ( s = 0 ; s < 2 ; s++ ) {
+        free( h->column_out[s] );
+        free( h->column_in[s] );
+    }
+    free( h );
+}
@@ -0,0 +1,56 @@
+/*
+ Halo exchange of a local 2D-subdomain with one ghost row/column on each side.
+
+ All the sends and receives of one subdomain are set up once as persistent
+ requests (MPI_Send_init/MPI_Recv_init) and only started and waited on every
+ iteration. Rows go straight from the array, columns are packed into and
+ unpacked from contiguous buffers. A message carries the direction it travels
+ as its tag, so a receive from north matches the send to south of the
+ neighbor. Create one halo per array, the solvers swap them together with
+ u_current and u_previous.
+
+ With HALO_EXCHANGE=neighbor in the environment a full exchange (all sides
+ sent and received) is one MPI_Ineighbor_alltoallw over the cartesian
+ communicator instead, persistent (MPI_Neighbor_alltoallw_init) with an
+ MPI-4 library. Its neighbors are north, south, west, east, the order
+ MPI_Cart_create defines them in, and missing ones are MPI_PROC_NULL.
+ Partial exchanges, as Gauss-Seidel's, cannot be matched by a collective
+ and always go point to point.
+*/
+#ifndef HALO_H
+#define HALO_H
+
+#include "mpi.h"
+
+#define HALO_NORTH 1
+#define HALO_SOUTH 2
+#define HALO_WEST  4
+#define HALO_EAST  8
+#define HALO_ALL   15
+
+#define HALO_P2P      0
+#define HALO_NEIGHBOR 1
+
+typedef struct {
+    double ** u;            //subdomain with ghost cells, (rows+2)x(cols+2)
+    int rows, cols;         //local dimensions without ghost cells
+    int neighbors[4];       //north, south, west, east, negative if none
+    MPI_Request send[4], recv[4];
+    double * column_out[2]; //packed west and east columns to send
+    double * column_in[2];  //west and east ghost columns received
+    int sending, receiving; //sides started by halo_start
+    int backend;            //HALO_P2P or HALO_NEIGHBOR
+    MPI_Comm comm;
+    int counts[4];          //neighbor collective arguments, addresses from MPI_BOTTOM
+    MPI_Aint out[4], in[4];
+    MPI_Datatype types[4];
+    MPI_Request collective;
+    int collective_started;
+} halo;
+
+halo * halo_create ( double ** u, int local[2], int north, int south, int west, int east, MPI_Comm comm );
+void halo_start ( halo * h, int send_sides, int recv_sides );
+void halo_wait ( halo * h );
+void halo_free ( halo * h );
+
+#endif
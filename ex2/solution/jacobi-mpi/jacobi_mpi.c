@@ -4,8 +4,10 @@
 #include <sys/types.h>
 #include <math.h>
 #include <sys/time.h>
+#include <omp.h>
 #include "mpi.h"
 #include "utils.h"
+#include "halo.h"
 
 
 int converge(double ** u_previous, double ** u_current, int Xm, int Ym, int X, int Y) {
@@ -22,6 +24,7 @@ int converge(double ** u_previous, double ** u_current, int Xm, int Ym, int X, i
 
 void Jacobi(double ** u_previous, double ** u_current, int X_min, int X_max, int Y_min, int Y_max) {
     int i,j;
+    #pragma omp parallel for schedule(static) private(j)
     for (i=X_min;i<X_max;i++)
         for (j=Y_min;j<Y_max;j++)
             u_current[i][j]=(u_previous[i-1][j]+u_previous[i+1][j]+u_previous[i][j-1]+u_previous[i][j+1])/4.0;
@@ -29,7 +32,7 @@ void Jacobi(double ** u_previous, double ** u_current, int X_min, int X_max, int
 
 
 int main(int argc, char ** argv) {
-    int rank,size;
+    int rank,size,provided;
     int global[2],local[2]; //global matrix dimensions and local matrix dimensions (2D-domain, 2D-subdomain)
     int global_padded[2];   //padded global matrix dimensions (if padding is not needed, global_padded=global)
     int grid[2];            //processor grid dimensions
@@ -39,14 +42,20 @@ int main(int argc, char ** argv) {
     double omega;           //relaxation factor - useless for Jacobi
 
 
-    struct timeval tts,ttf,tcs,tcf,tconvs,tconvf;   //Timers: total-> tts,ttf, computation -> tcs,tcf, convergence -> tconvs,tconvf
-    double ttotal=0,tcomp=0,tconv=0,total_time,comp_time,conv_time;
+    struct timeval tts,ttf,tcs,tcf,tconvs,tconvf,tws,twf;   //Timers: total-> tts,ttf, computation -> tcs,tcf, convergence -> tconvs,tconvf, halo wait -> tws,twf
+    double ttotal=0,tcomp=0,tconv=0,twait=0,total_time,comp_time,conv_time,wait_time;
 
     double ** U, ** u_current, ** u_previous, ** swap; //Global matrix, local current and previous matrices, pointer to swap between current and previous
 
-    MPI_Init(&argc,&argv);
+    //only the master thread calls MPI, between the parallel kernels
+    MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
     MPI_Comm_size(MPI_COMM_WORLD,&size);
     MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+    if (provided<MPI_THREAD_FUNNELED) {
+        if (rank==0)
+            fprintf(stderr,"MPI does not support MPI_THREAD_FUNNELED\n");
+        MPI_Abort(MPI_COMM_WORLD,-1);
+    }
 
     //----Read 2D-domain dimensions and process grid dimensions from stdin----//
 
@@ -161,15 +170,6 @@ int main(int argc, char ** argv) {
         free2d(U);
     }
 
-    //----Define datatypes or allocate buffers for message passing----//
-    MPI_Datatype column, row;
-
-    MPI_Type_vector(local[0] + 1, 1, local[1] + 2, MPI_DOUBLE, &column);
-    MPI_Type_commit(&column);
-
-    MPI_Type_contiguous(local[1] + 2, MPI_DOUBLE, &row);
-    MPI_Type_commit(&row);
-
     //----Find the 4 neighbors with which a process exchanges messages----//
 
     /*Make sure you handle non-existing
@@ -178,6 +178,11 @@ int main(int argc, char ** argv) {
     MPI_Cart_shift(CART_COMM, 0, 1, &north, &south);
     MPI_Cart_shift(CART_COMM, 1, 1, &west, &east);
 
+    //----Set up the halo exchange of both arrays once----//
+    halo * h_current, * h_previous, * hswap;
+    h_current = halo_create(u_current, local, north, south, west, east, CART_COMM);
+    h_previous = halo_create(u_previous, local, north, south, west, east, CART_COMM);
+
     //---Define the iteration ranges per process-----//
     int i_min,i_max,j_min,j_max;
     if(north > -1)
@@ -206,8 +211,23 @@ int main(int argc, char ** argv) {
         -boundary processes and padded global array
     */
 
-    MPI_Request requests[8];
-    int requests_cnt = 0;
+    //---The interior does not read ghost cells and is computed while the halos are in flight---//
+    int in_i_min,in_i_max,in_j_min,in_j_max;
+    //kept inside [i_min,i_max) and [j_min,j_max), so the strips around it never reach
+    //the fixed global boundary of a subdomain only one row or column thick
+    in_i_min = i_min > 2 ? i_min : 2;
+    if(in_i_min > i_max)
+        in_i_min = i_max;
+    in_i_max = i_max < local[0] ? i_max : local[0];
+    if(in_i_max < in_i_min)
+        in_i_max = in_i_min;
+    in_j_min = j_min > 2 ? j_min : 2;
+    if(in_j_min > j_max)
+        in_j_min = j_max;
+    in_j_max = j_max < local[1] ? j_max : local[1];
+    if(in_j_max < in_j_min)
+        in_j_max = in_j_min;
+
     //----Computational core----//   
     gettimeofday(&tts, NULL);
     #ifdef TEST_CONV
@@ -224,29 +244,34 @@ int main(int argc, char ** argv) {
         swap = u_previous;
         u_previous = u_current;
         u_current = swap;
+        hswap = h_previous;
+        h_previous = h_current;
+        h_current = hswap;
 
-        requests_cnt = 0;
-        if(north > -1) {
-            MPI_Irecv(&(u_previous[0][0]), 1, row, north, north * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-            MPI_Isend(&(u_previous[1][0]), 1, row, north, rank * 10 + north, CART_COMM, &requests[requests_cnt++]);
-        }
-        if(south > -1) {
-            MPI_Irecv(&(u_previous[local[0] + 1][0]), 1, row, south, south * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-            MPI_Isend(&(u_previous[local[0]][0]), 1, row, south, rank * 10 + south, CART_COMM, &requests[requests_cnt++]);
-        }
-        if(west > -1) {
-            MPI_Irecv(&(u_previous[0][0]), 1, column, west, west * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-            MPI_Isend(&(u_previous[0][1]), 1, column, west, rank * 10 + west, CART_COMM, &requests[requests_cnt++]);
-        }
-        if(east > -1) {
-            MPI_Irecv(&(u_previous[0][local[1] + 1]), 1, column, east, east * 10 + rank, CART_COMM, &requests[requests_cnt++]);
-            MPI_Isend(&(u_previous[0][local[1]]), 1, column, east, rank * 10 + east, CART_COMM, &requests[requests_cnt++]);
-        }
-        MPI_Waitall(requests_cnt, requests, MPI_STATUSES_IGNORE);
+        halo_start(h_previous, HALO_ALL, HALO_ALL);
+
+        gettimeofday(&tcs, NULL);
+
+        Jacobi(u_previous, u_current, in_i_min, in_i_max, in_j_min, in_j_max);
+
+        gettimeofday(&tcf, NULL);
+        tcomp += (tcf.tv_sec - tcs.tv_sec)
+            + (tcf.tv_usec - tcs.tv_usec) * 0.000001;
+
+        //whatever is left of the exchange after the interior is exposed communication
+        gettimeofday(&tws, NULL);
+        halo_wait(h_previous);
+        gettimeofday(&twf, NULL);
+        twait += (twf.tv_sec - tws.tv_sec)
+            + (twf.tv_usec - tws.tv_usec) * 0.000001;
 
+        //boundary strip: top and bottom rows, then the left and right columns in between
         gettimeofday(&tcs, NULL);
 
-        Jacobi(u_previous, u_current, i_min, i_max, j_min, j_max);
+        Jacobi(u_previous, u_current, i_min, in_i_min, j_min, j_max);
+        Jacobi(u_previous, u_current, in_i_max, i_max, j_min, j_max);
+        Jacobi(u_previous, u_current, in_i_min, in_i_max, j_min, in_j_min);
+        Jacobi(u_previous, u_current, in_i_min, in_i_max, in_j_max, j_max);
 
         gettimeofday(&tcf, NULL);
         tcomp += (tcf.tv_sec - tcs.tv_sec)
@@ -269,9 +294,12 @@ int main(int argc, char ** argv) {
     }
     gettimeofday(&ttf,NULL);
     ttotal=(ttf.tv_sec-tts.tv_sec)+(ttf.tv_usec-tts.tv_usec)*0.000001;
+    halo_free(h_current);
+    halo_free(h_previous);
     MPI_Reduce(&ttotal,&total_time,1,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
     MPI_Reduce(&tcomp,&comp_time,1,MPI_DOUBLE,MPI_MAX,0,MPI_COMM_WORLD);
     MPI_Reduce(&tconv, &conv_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&twait, &wait_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 
 
     //----Rank 0 gathers local matrices back to the global matrix----//
@@ -307,7 +335,7 @@ int main(int argc, char ** argv) {
     //----Printing results----//
 
     if (rank==0) {
-        printf("Jacobi X %d Y %d Px %d Py %d Iter %d ComputationTime %lf Convergence Time %lf TotalTime %lf midpoint %lf processes %d\n",global[0],global[1],grid[0],grid[1],t,comp_time,conv_time,total_time,U[global[0]/2][global[1]/2], size);
+        printf("Jacobi X %d Y %d Px %d Py %d Iter %d ComputationTime %lf Convergence Time %lf TotalTime %lf midpoint %lf processes %d ExposedCommTime %lf threads %d\n",global[0],global[1],grid[0],grid[1],t,comp_time,conv_time,total_time,U[global[0]/2][global[1]/2], size, wait_time, omp_get_max_threads());
 
         #ifdef PRINT_RESULTS
         char * s=malloc(50*sizeof(char));
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+## Give the Job a descriptive name
+#PBS -N run_heat_halo
+
+## Output and error files
+#PBS -o run_heat_halo.out
+#PBS -e run_heat_halo.err
+
+## How many machines should we get? 
+#PBS -l nodes=8:ppn=8
+
+##How long should the job run for?
+#PBS -l walltime=00:30:00
+
+## Compares the point-to-point halo exchange with MPI_Neighbor_alltoallw
+## (HALO_EXCHANGE, see halo.h), results go to HaloResults_<backend>_<size>
+## in the ScalabilityResultsMPI format
+
+module load openmpi
+cd /home/parallel/parlab13/vitsalis/heat_diffusion
+
+backends=( p2p neighbor )
+sizes=( 2048 4096 6144 )
+procs=( 8 16 32 64 )
+declare -A grid=( [8]="4 2" [16]="4 4" [32]="8 4" [64]="8 8" )
+solvers=( jacobi redblack )
+
+for backend in "${backends[@]}";
+do
+	for size in "${sizes[@]}";
+	do
+		for solver in "${solvers[@]}";
+		do
+			for np in "${procs[@]}";
+			do
+				HALO_EXCHANGE=${backend} mpirun -x HALO_EXCHANGE -np ${np} --map-by node ./${solver} ${size} ${size} ${grid[${np}]} >> HaloResults_${backend}_${size};
+			done
+		done
+	done
+done
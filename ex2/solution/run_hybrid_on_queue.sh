@@ -0,0 +1,63 @@
+#!/bin/bash
+
+## Give the Job a descriptive name
+#PBS -N run_heat_hybrid
+
+## Output and error files
+#PBS -o run_heat_hybrid.out
+#PBS -e run_heat_hybrid.err
+
+## How many machines should we get? 
+#PBS -l nodes=8:ppn=8
+
+##How long should the job run for?
+#PBS -l walltime=00:30:00
+
+## One MPI rank per socket, or per NUMA domain with
+## qsub -v HYBRID_DOMAIN=numa, OpenMP threads on its cores. Same core counts as ScalabilityResultsMPI_<size>,
+## results go to HybridResultsMPI_<size>, with the thread count appended
+
+module load openmpi
+cd /home/parallel/parlab13/vitsalis/heat_diffusion
+
+domain=${HYBRID_DOMAIN:-socket}
+if [ "${domain}" != "socket" ] && [ "${domain}" != "numa" ]; then
+	echo "HYBRID_DOMAIN must be socket or numa" >&2;
+	exit 1;
+fi
+cores_per_domain=$(lscpu | awk -F: '/Core\(s\) per socket/ { print $2 + 0 }')
+if [ "${domain}" == "numa" ]; then
+	cores_per_domain=$(( $(nproc) / $(lscpu | awk -F: '/NUMA node\(s\)/ { print $2 + 0 }') ));
+fi
+
+sizes=( 2048 4096 6144 )
+cores=( 8 16 32 64 )
+solvers=( jacobi gauss redblack )
+
+export OMP_NUM_THREADS=${cores_per_domain}
+export OMP_PROC_BIND=close
+export OMP_PLACES=cores
+
+for size in "${sizes[@]}";
+do
+	for solver in "${solvers[@]}";
+	do
+		for ncores in "${cores[@]}";
+		do
+			np=$(( ncores / cores_per_domain ));
+			## whole domains only, and a power of two ranks for the Px x Py grid
+			if [ $(( ncores % cores_per_domain )) -ne 0 ] || [ ${np} -eq 0 ] || [ $(( np & (np - 1) )) -ne 0 ]; then
+				echo "skipping ${ncores} cores: not a power of two of ${cores_per_domain}-core ${domain}s" >&2;
+				continue;
+			fi
+			## Px >= Py, both powers of two
+			px=1; py=1;
+			while [ $(( px * py )) -lt ${np} ]; do
+				if [ ${px} -le ${py} ]; then px=$(( px * 2 )); else py=$(( py * 2 )); fi;
+			done
+			mpirun -np ${np} --map-by ppr:1:${domain}:pe=${cores_per_domain} --bind-to core \
+				-x OMP_NUM_THREADS -x OMP_PROC_BIND -x OMP_PLACES \
+				./${solver} ${size} ${size} ${px} ${py} >> HybridResultsMPI_${size};
+		done
+	done
+done